@@ -4,6 +4,22 @@ else
 	rm bin/*
 fi
 
-g++ -g -O0 -I . -o bin/interrupts_EP interrupts_student1_student2_EP.cpp
-g++ -g -O0 -I . -o bin/interrupts_RR interrupts_student1_student2_RR.cpp
-g++ -g -O0 -I . -o bin/interrupts_EP_RR interrupts_student1_student2_EP_RR.cpp
\ No newline at end of file
+g++ -g -O0 -pthread -I . -o bin/interrupts_EP interrupts_101262847_101301514_EP.cpp
+g++ -g -O0 -pthread -I . -o bin/interrupts_RR interrupts_101262847_101301514_RR.cpp
+g++ -g -O0 -pthread -I . -o bin/interrupts_EP_RR interrupts_101262847_101301514_EP_RR.cpp
+g++ -g -O0 -pthread -I . -o bin/interrupts_EDF interrupts_101262847_101301514_EDF.cpp
+g++ -g -O0 -pthread -I . -o bin/interrupts_RM interrupts_101262847_101301514_RM.cpp
+
+# Allocation-checking builds: fail if the simulation loop touches the heap
+g++ -g -O0 -pthread -I . -DCOUNT_ALLOCATIONS -o bin/interrupts_EP_alloc_check interrupts_101262847_101301514_EP.cpp
+g++ -g -O0 -pthread -I . -DCOUNT_ALLOCATIONS -o bin/interrupts_RR_alloc_check interrupts_101262847_101301514_RR.cpp
+g++ -g -O0 -pthread -I . -DCOUNT_ALLOCATIONS -o bin/interrupts_EP_RR_alloc_check interrupts_101262847_101301514_EP_RR.cpp
+g++ -g -O0 -pthread -I . -DCOUNT_ALLOCATIONS -o bin/interrupts_EDF_alloc_check interrupts_101262847_101301514_EDF.cpp
+g++ -g -O0 -pthread -I . -DCOUNT_ALLOCATIONS -o bin/interrupts_RM_alloc_check interrupts_101262847_101301514_RM.cpp
+
+# Profiling builds: write profile.txt and profile_trace.json at exit
+g++ -g -O2 -pthread -I . -DSIM_PROFILE -o bin/interrupts_EP_profile interrupts_101262847_101301514_EP.cpp
+g++ -g -O2 -pthread -I . -DSIM_PROFILE -o bin/interrupts_RR_profile interrupts_101262847_101301514_RR.cpp
+g++ -g -O2 -pthread -I . -DSIM_PROFILE -o bin/interrupts_EP_RR_profile interrupts_101262847_101301514_EP_RR.cpp
+g++ -g -O2 -pthread -I . -DSIM_PROFILE -o bin/interrupts_EDF_profile interrupts_101262847_101301514_EDF.cpp
+g++ -g -O2 -pthread -I . -DSIM_PROFILE -o bin/interrupts_RM_profile interrupts_101262847_101301514_RM.cpp
\ No newline at end of file
@@ -12,12 +12,336 @@
 #include<fstream>
 #include<string>
 #include<vector>
+#include<array>
 #include<tuple>
 #include<random>
 #include<utility>
 #include<sstream>
 #include<iomanip>
 #include<algorithm>
+#include<cstdint>
+#include<cstring>
+#include<charconv>
+#include<cstdlib>
+#include<cmath>
+#include<climits>
+#include<cerrno>
+#include<stdexcept>
+#include<new>
+#include<chrono>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<deque>
+#include<atomic>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<sys/stat.h>
+#include<sys/time.h>
+#include<unistd.h>
+#ifdef SIM_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include<x86intrin.h>
+#endif
+#endif
+
+//Build with -DCOUNT_ALLOCATIONS to replace the global operator new with one that
+//counts calls made by the current thread. The simulation loop then checks that it performed no heap allocations
+//after start-up (see begin_steady_state/end_steady_state).
+#ifdef COUNT_ALLOCATIONS
+thread_local std::size_t allocation_count = 0;
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+//GCC cannot tell that these pair with the operator new above
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#pragma GCC diagnostic pop
+#endif
+
+//Build with -DSIM_PROFILE to record where the simulation loop spends its time. The
+//loop is split into phases; every PROFILE_PHASE() switch charges the ticks since the
+//previous switch to the phase being left, and rows written to the logs are charged
+//to the logging phase. Each run is profiled on its own thread and added to a
+//process-wide report when it ends, so batch and cluster runs are all counted. At
+//exit write_profile() dumps profile.txt and a Chrome trace (profile_trace.json, open
+//it in chrome://tracing or Perfetto, one track per thread). Without the flag the
+//macros compile to nothing.
+enum profile_phases {
+    PHASE_ADMISSION,
+    PHASE_WAIT_QUEUE,
+    PHASE_DISPATCH,
+    PHASE_LOGGING,
+    NUM_PHASES
+};
+
+#ifdef SIM_PROFILE
+const char* const profile_phase_names[] = {
+    "admission",
+    "wait queue",
+    "dispatch/execution",
+    "output logging"
+};
+
+//Cycle counter on x86, nanoseconds elsewhere
+uint64_t profile_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct profile_span {
+    profile_phases  phase;
+    uint64_t        start;
+    uint64_t        end;
+    unsigned int    thread;     //set when the run is added to the report
+};
+
+struct sim_profiler {
+    bool            active = false;
+    profile_phases  phase = PHASE_ADMISSION;
+    uint64_t        phase_start = 0;
+
+    uint64_t        ticks[NUM_PHASES] = {};
+    uint64_t        entries[NUM_PHASES] = {};     //times the phase was switched into
+    uint64_t        events[NUM_PHASES] = {};      //log rows caused by the phase
+    std::size_t     allocations[NUM_PHASES] = {}; //only counted with COUNT_ALLOCATIONS
+    std::size_t     phase_allocations = 0;
+
+    std::size_t     ready_high_water = 0;
+    std::size_t     wait_high_water = 0;
+
+    //Spans for the Chrome trace. The buffer is reserved up front so recording never
+    //allocates; spans beyond its capacity are only counted.
+    std::vector<profile_span>   spans;
+    std::size_t                 dropped_spans = 0;
+
+    uint64_t                                run_start_ticks = 0;
+    uint64_t                                run_end_ticks = 0;
+    std::chrono::steady_clock::time_point   run_start_time;
+    std::chrono::steady_clock::time_point   run_end_time;
+};
+
+thread_local sim_profiler profiler;
+
+//Sum of every run profiled so far, on any thread
+struct profile_report {
+    std::mutex      lock;
+    unsigned long   runs = 0;
+    unsigned int    threads = 0;    //threads that have reported a run
+
+    uint64_t        ticks[NUM_PHASES] = {};
+    uint64_t        entries[NUM_PHASES] = {};
+    uint64_t        events[NUM_PHASES] = {};
+    std::size_t     allocations[NUM_PHASES] = {};
+
+    std::size_t     ready_high_water = 0;
+    std::size_t     wait_high_water = 0;
+
+    uint64_t        run_ticks = 0;      //summed over runs, which may overlap in time
+    double          run_us = 0;
+    uint64_t        first_start_ticks = UINT64_MAX;
+
+    std::vector<profile_span>   spans;
+    std::size_t                 dropped_spans = 0;
+};
+
+profile_report profile_totals;
+thread_local unsigned int profile_thread = 0;   //track of this thread in the trace, 0 until its first run
+const std::size_t max_report_spans = 1 << 20;   //a long server run keeps only the first spans
+
+std::size_t profile_allocations() {
+#ifdef COUNT_ALLOCATIONS
+    return allocation_count;
+#else
+    return 0;
+#endif
+}
+
+//Charge the time since the last switch to the current phase
+void profile_charge(uint64_t now, std::size_t allocations) {
+    profiler.ticks[profiler.phase] += now - profiler.phase_start;
+    profiler.allocations[profiler.phase] += allocations - profiler.phase_allocations;
+    if (profiler.spans.size() < profiler.spans.capacity()) {
+        profiler.spans.push_back({profiler.phase, profiler.phase_start, now, 0});
+    } else {
+        profiler.dropped_spans++;
+    }
+}
+
+//Leave the current phase and enter next_phase
+void profile_switch(profile_phases next_phase) {
+    if (!profiler.active) {
+        return;
+    }
+    profiler.entries[next_phase]++;
+    if (next_phase == profiler.phase) {
+        return;
+    }
+
+    uint64_t now = profile_ticks();
+    std::size_t allocations = profile_allocations();
+    profile_charge(now, allocations);
+
+    profiler.phase = next_phase;
+    profiler.phase_start = now;
+    profiler.phase_allocations = allocations;
+}
+
+void profile_queue_lengths(std::size_t ready_length, std::size_t wait_length) {
+    profiler.ready_high_water = std::max(profiler.ready_high_water, ready_length);
+    profiler.wait_high_water = std::max(profiler.wait_high_water, wait_length);
+}
+
+//Charges everything done during its lifetime to PHASE_LOGGING
+struct profile_log_scope {
+    profile_phases  previous;
+
+    profile_log_scope() : previous(profiler.phase) {
+        if (profiler.active) {
+            profiler.events[previous]++;
+            profile_switch(PHASE_LOGGING);
+        }
+    }
+    ~profile_log_scope() {
+        if (profiler.active) {
+            profiler.entries[previous]--; //returning is not a new entry
+            profile_switch(previous);
+        }
+    }
+};
+
+void profile_begin(std::size_t span_capacity) {
+    profiler = sim_profiler();
+    profiler.spans.reserve(span_capacity);
+    profiler.run_start_time = std::chrono::steady_clock::now();
+    profiler.run_start_ticks = profile_ticks();
+    profiler.phase_start = profiler.run_start_ticks;
+    profiler.phase_allocations = profile_allocations();
+    profiler.active = true;
+}
+
+void profile_end() {
+    profiler.run_end_ticks = profile_ticks();
+    profile_charge(profiler.run_end_ticks, profile_allocations());
+    profiler.active = false;
+    profiler.run_end_time = std::chrono::steady_clock::now();
+}
+
+//Add the run profiled on this thread to profile_totals. This allocates, so it is
+//called once the loop's allocations have been checked.
+void profile_report_run() {
+    std::lock_guard<std::mutex> guard(profile_totals.lock);
+    if (profile_thread == 0) {
+        profile_thread = ++profile_totals.threads;
+    }
+    profile_totals.runs++;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        profile_totals.ticks[p] += profiler.ticks[p];
+        profile_totals.entries[p] += profiler.entries[p];
+        profile_totals.events[p] += profiler.events[p];
+        profile_totals.allocations[p] += profiler.allocations[p];
+    }
+    profile_totals.ready_high_water = std::max(profile_totals.ready_high_water, profiler.ready_high_water);
+    profile_totals.wait_high_water = std::max(profile_totals.wait_high_water, profiler.wait_high_water);
+    profile_totals.run_ticks += profiler.run_end_ticks - profiler.run_start_ticks;
+    profile_totals.run_us += std::chrono::duration<double, std::micro>(profiler.run_end_time - profiler.run_start_time).count();
+    profile_totals.first_start_ticks = std::min(profile_totals.first_start_ticks, profiler.run_start_ticks);
+
+    for (const auto &span : profiler.spans) {
+        if (profile_totals.spans.size() < max_report_spans) {
+            profile_totals.spans.push_back({span.phase, span.start, span.end, profile_thread});
+        } else {
+            profile_totals.dropped_spans++;
+        }
+    }
+    profile_totals.dropped_spans += profiler.dropped_spans;
+}
+
+//Dump the profile as a text summary and as a Chrome trace
+void write_profile() {
+    profile_report &report = profile_totals;
+    std::lock_guard<std::mutex> guard(report.lock);
+    uint64_t total_ticks = report.run_ticks;
+    double total_us = report.run_us;
+    double ticks_per_us = total_us > 0 ? total_ticks / total_us : 1;
+
+    std::ofstream summary("profile.txt");
+    summary << "Simulation loop profile (" << total_ticks << " ticks, "
+            << std::fixed << std::setprecision(1) << total_us << " us)\n";
+    if (report.runs > 1) {
+        summary << "Runs: " << report.runs << " on " << report.threads
+                << " threads, ticks and time summed over the runs\n";
+    }
+    summary << "+" << std::setfill('-') << std::setw(87) << "+" << "\n" << std::setfill(' ');
+    summary << "|" << std::setw(19) << "Phase" << " |" << std::setw(16) << "Ticks" << " |"
+            << std::setw(7) << "Share" << " |" << std::setw(12) << "Entries" << " |"
+            << std::setw(10) << "Events" << " |" << std::setw(12) << "Allocations" << " |\n";
+    summary << "+" << std::setfill('-') << std::setw(87) << "+" << "\n" << std::setfill(' ');
+    for (int p = 0; p < NUM_PHASES; p++) {
+        double share = total_ticks ? 100.0 * report.ticks[p] / total_ticks : 0;
+        summary << "|" << std::setw(19) << profile_phase_names[p]
+                << " |" << std::setw(16) << report.ticks[p]
+                << " |" << std::setw(6) << share << "%"
+                << " |" << std::setw(12) << report.entries[p]
+                << " |" << std::setw(10) << report.events[p]
+#ifdef COUNT_ALLOCATIONS
+                << " |" << std::setw(12) << report.allocations[p]
+#else
+                << " |" << std::setw(12) << "n/a"
+#endif
+                << " |\n";
+    }
+    summary << "+" << std::setfill('-') << std::setw(87) << "+" << "\n" << std::setfill(' ');
+    summary << "Ready queue high-water mark: " << report.ready_high_water << "\n";
+    summary << "Wait queue high-water mark: " << report.wait_high_water << "\n";
+    summary << "Trace spans recorded: " << report.spans.size()
+            << " (dropped " << report.dropped_spans << ")\n";
+
+    std::ofstream trace("profile_trace.json");
+    trace << "{\"traceEvents\":[\n";
+    trace << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const auto &span : report.spans) {
+        if (span.end == span.start) {
+            continue;
+        }
+        trace << (first ? "" : ",\n")
+              << "{\"name\":\"" << profile_phase_names[span.phase] << "\",\"cat\":\"simulation\",\"ph\":\"X\""
+              << ",\"ts\":" << (span.start - report.first_start_ticks) / ticks_per_us
+              << ",\"dur\":" << (span.end - span.start) / ticks_per_us
+              << ",\"pid\":1,\"tid\":" << span.thread << "}";
+        first = false;
+    }
+    trace << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+    std::cout << "Profile generated in profile.txt and profile_trace.json" << std::endl;
+}
+
+#define PROFILE_PHASE(sim, next_phase) \
+    (profile_queue_lengths((sim).ready_queue.size(), (sim).wait_queue.size()), profile_switch(next_phase))
+#define PROFILE_LOG_SCOPE() profile_log_scope profile_scope_guard
+#else
+#define PROFILE_PHASE(sim, next_phase) ((void)0)
+#define PROFILE_LOG_SCOPE() ((void)0)
+void write_profile() {}
+#endif
 
 //An enumeration of states to make assignment easier
 enum states {
@@ -26,34 +350,122 @@ enum states {
     RUNNING,
     WAITING,
     TERMINATED,
-    NOT_ASSIGNED
+    NOT_ASSIGNED,
+    SUSP_READY,     //swapped out to the backing store, ready to run once swapped in
+    SUSP_WAIT,      //swapped out while waiting for I/O
+    SWITCHING       //on the CPU, but the context switch to it is not done yet
 };
-std::ostream& operator<<(std::ostream& os, const enum states& s) { //Overloading the << operator to make printing of the enum easier
-
-	std::string state_names[] = {
+constexpr const char* state_names[] = {
                                 "NEW",
                                 "READY",
                                 "RUNNING",
                                 "WAITING",
                                 "TERMINATED",
-                                "NOT_ASSIGNED"
-    };
-    return (os << state_names[s]);
+                                "NOT_ASSIGNED",
+                                "SUSP_READY",
+                                "SUSP_WAIT",
+                                "SWITCHING"
+};
+constexpr std::size_t num_states = sizeof(state_names) / sizeof(state_names[0]);
+
+const char* state_name(states s) {
+    return state_names[s];
+}
+
+std::ostream& operator<<(std::ostream& os, const enum states& s) { //Overloading the << operator to make printing of the enum easier
+    return (os << state_name(s));
 }
 
+//State names right-aligned to Width characters, built at compile time. Names longer
+//than Width are kept whole, the same way std::setw lets them overflow.
+template<std::size_t Width>
+struct padded_state_names {
+    char            text[num_states][Width + 16];
+    std::size_t     length[num_states];
+
+    constexpr padded_state_names() : text(), length() {
+        for (std::size_t s = 0; s < num_states; s++) {
+            std::size_t name_length = 0;
+            while (state_names[s][name_length] != '\0') {
+                name_length++;
+            }
+            std::size_t padding = name_length < Width ? Width - name_length : 0;
+            for (std::size_t i = 0; i < padding; i++) {
+                text[s][i] = ' ';
+            }
+            for (std::size_t i = 0; i < name_length; i++) {
+                text[s][padding + i] = state_names[s][i];
+            }
+            length[s] = padding + name_length;
+        }
+    }
+};
+
+template<std::size_t Width>
+constexpr padded_state_names<Width> padded_states{};
+
+//Fixed-width row formatter. It writes straight into a caller's char buffer; column
+//widths are template arguments, so each field is a std::to_chars call plus padding.
+//Output matches what std::setw with a ' ' fill produces.
+struct row_writer {
+    char* out;
+
+    //Right-align a number in Width characters
+    template<std::size_t Width, typename T>
+    row_writer& field(T value) {
+        char digits[24];
+        std::size_t length = std::to_chars(digits, digits + sizeof(digits), value).ptr - digits;
+        if (length < Width) {
+            std::memset(out, ' ', Width - length);
+            out += Width - length;
+        }
+        std::memcpy(out, digits, length);
+        out += length;
+        return *this;
+    }
+
+    //Right-align a string literal in Width characters
+    template<std::size_t Width, std::size_t N>
+    row_writer& field(const char (&value)[N]) {
+        if (N - 1 < Width) {
+            std::memset(out, ' ', Width - (N - 1));
+            out += Width - (N - 1);
+        }
+        return text(value);
+    }
+
+    //Right-align a state name in Width characters
+    template<std::size_t Width>
+    row_writer& state(states s) {
+        std::memcpy(out, padded_states<Width>.text[s], padded_states<Width>.length[s]);
+        out += padded_states<Width>.length[s];
+        return *this;
+    }
+
+    //Copy a string literal as is
+    template<std::size_t N>
+    row_writer& text(const char (&value)[N]) {
+        std::memcpy(out, value, N - 1);
+        out += N - 1;
+        return *this;
+    }
+};
+
 struct memory_partition{
     unsigned int    partition_number;
     unsigned int    size;
     int             occupied;
-} memory_paritions[] = {
-    {1, 40, -1},
-    {2, 25, -1},
-    {3, 15, -1},
-    {4, 10, -1},
-    {5, 8, -1},
-    {6, 2, -1}
 };
 
+//Partition layouts known at compile time get a fit search specialized for their
+//sizes (see fixed_partitions). Any other --partitions layout uses the generic scan.
+enum partition_layouts {
+    LAYOUT_GENERIC,
+    LAYOUT_DEFAULT
+};
+
+constexpr std::array<unsigned int, 6> default_partition_sizes = {40, 25, 15, 10, 8, 2};
+
 struct PCB{
     int             PID;
     unsigned int    size;
@@ -65,24 +477,389 @@ struct PCB{
     enum states     state;
     unsigned int    io_freq;
     unsigned int    io_duration;
+    unsigned int    io_device;      //optional 7th input field, 0 = no contention
+    unsigned int    deadline;       //optional 8th input field, relative deadline of each job, 0 = none
+    unsigned int    period;         //optional 9th input field, 0 = a single job
+};
+
+//Real-time policies. EDF runs the job with the earliest absolute deadline, RM the task
+//with the shortest period. Both preempt as soon as a more urgent job is ready.
+enum rt_policies {
+    RT_NONE,
+    RT_EDF,
+    RT_RM
+};
+
+//Order in which an I/O device serves the requests queued on it
+enum io_disciplines {
+    IO_FIFO,
+    IO_PRIORITY     //lowest PID first, like ExternalPriority
+};
+
+struct io_device_config {
+    unsigned int    concurrency;    //requests the device serves at the same time
+    io_disciplines  discipline;
+};
+
+//Page replacement policy of the paging model
+enum replacement_policies {
+    REPLACE_FIFO,
+    REPLACE_LRU,
+    REPLACE_CLOCK
+};
+const char* const replacement_policy_names[] = {"FIFO", "LRU", "CLOCK"};
+
+struct paging_config {
+    unsigned int            frames;
+    unsigned int            page_size;
+    replacement_policies    policy;
+    unsigned int            tlb_entries = 16;
+    unsigned int            fault_latency = 10;     //time to bring a page in from the backing store
+    unsigned int            access_interval = 5;    //CPU time between two memory accesses
+};
+
+//How the cluster dispatcher picks a node for an arrival
+enum placement_policies {
+    PLACE_ROUND_ROBIN,
+    PLACE_LEAST_LOADED,     //smallest predicted CPU backlog
+    PLACE_BEST_FIT          //tightest free partition, like assign_memory across nodes
+};
+const char* const placement_policy_names[] = {"round-robin", "least-loaded", "best-fit"};
+
+//Summary of a finished run, filled in if sim_config::metrics is set
+struct sim_metrics {
+    unsigned int    end_time;
+    unsigned int    admitted;
+    unsigned int    terminated;
+    unsigned long   cpu_busy;       //time the CPU spent running processes
+    unsigned long   swap_outs;
+    unsigned long   swap_ins;
+    unsigned long   page_accesses;
+    unsigned long   tlb_hits;
+    unsigned long   page_faults;
+    unsigned long   evictions;
+    unsigned long   total_wait;     //time processes spent in the ready queue
+    unsigned int    max_wait;       //longest single stay in the ready queue
+    unsigned int    starved;        //processes that waited longer than the starvation threshold
+    unsigned long   jobs;           //EDF and RM: jobs completed by finished tasks
+    unsigned long   deadline_misses;
+    unsigned long   context_switches;
+    unsigned long   switch_overhead;    //CPU time spent switching, cache penalty included
+    unsigned long   interrupts;         //I/O completion interrupts raised
+    unsigned long   isr_time;           //CPU time spent in interrupt service routines
+    unsigned int    max_irq_latency;    //longest wait from I/O completion to READY
+    std::size_t     loop_allocations;   //COUNT_ALLOCATIONS builds: heap allocations made by the loop
+};
+
+//Run-time options, given on the command line (or in a server request)
+struct sim_config {
+    std::string                     input_file;
+    std::string                     policy;         //--policy, must match the binary if given
+    unsigned int                    quantum = 100;  //--quantum, time slice of RR and EP_RR
+    unsigned int                    horizon = 1000; //--horizon, EDF and RM release no periodic jobs from then on
+    std::vector<unsigned int>       partition_sizes;//--partitions, empty for the default layout
+    std::vector<io_device_config>   io_devices;     //device n is io_devices[n - 1]
+
+    //--swap: suspend processes to a backing store when memory is full
+    bool                            swapping = false;
+    unsigned int                    swap_out_latency = 0;
+    unsigned int                    swap_in_latency = 0;
+
+    //--context-switch: CPU time a dispatch costs, plus a penalty for a cold cache
+    unsigned int                    switch_cost = 0;
+    unsigned int                    cache_penalty = 0;
+    unsigned int                    cache_decay = 100;  //CPU time of other processes that makes the cache fully cold
+
+    //--interrupts: I/O completions are delivered by an interrupt whose service routine
+    //takes the CPU. Completions are coalesced until irq_batch are pending or the
+    //oldest has waited irq_timeout.
+    bool                            interrupts = false;
+    unsigned int                    isr_time = 0;
+    unsigned int                    irq_batch = 1;
+    unsigned int                    irq_timeout = 0;
+
+    //--aging: EP priority improves by one level per aging ms spent waiting, 0 for strict PID order
+    unsigned int                    aging = 0;
+    unsigned int                    starvation_threshold = 1000;    //--starvation
+    bool                            wait_report = false;            //set by --aging or --starvation
+
+    //--paging: paged virtual memory instead of the partition table
+    bool                            paging = false;
+    paging_config                   paging_options;
+
+    //--nodes: simulate a cluster of nodes, each with its own partition table and CPU
+    unsigned int                    nodes = 0;
+    placement_policies              placement = PLACE_ROUND_ROBIN;
+    bool                            migration = false;  //--migrate
+    unsigned int                    migration_latency = 0;
+    unsigned int                    migration_per_unit = 0; //extra transfer time per unit of size
+    unsigned int                    threads = 1;        //--threads, host threads running nodes or batch workloads, 0 for one per core
+    bool                            whole_workload = false; //cluster nodes: run until every arrival has been seen, even
+                                                            //after the CPU goes quiet between them
+
+    //--batch: the input file lists workload files to run one after another
+    bool                            batch = false;
+
+    //--serve: run as a daemon on a Unix domain socket
+    std::string                     serve_path;
+    unsigned int                    workers = 0;    //--workers, 0 for one per host core
+
+    //--stream: read arrivals as simulated time reaches them instead of up front
+    bool                            stream = false;
+    std::istream*                   arrival_stream = nullptr;
+    std::ostream*                   execution_sink = nullptr;   //rows are flushed here as they are made
+    std::ostream*                   memory_sink = nullptr;
+
+    sim_metrics*                    metrics = nullptr;
+    std::size_t                     max_log_size = 0;   //largest log a run may reserve, 0 for no limit
+    bool                            exit_on_allocations = true; //COUNT_ALLOCATIONS: exit if the loop allocated,
+                                                                //the server reports it in its reply instead
+};
+
+//State of one I/O device during a run
+struct io_device {
+    io_device_config        config;
+    unsigned int            in_service;     //requests currently being served
+    std::vector<uint32_t>   queue;          //slots waiting for the device
+    std::vector<unsigned int> freed_at;     //completion times seen in this wait-queue scan
+
+    unsigned long           requests;
+    unsigned long           busy_time;      //sum of service times started
+    unsigned long           total_delay;    //sum of time spent queued
+    unsigned int            max_delay;
+};
+
+//A physical page frame. FIFO and LRU keep the frames in use on a doubly linked list
+//(most recently loaded or used at the head, the victim at the tail), so every
+//access and replacement is O(1); Clock uses the reference bit and a hand instead.
+struct page_frame {
+    uint32_t    slot;           //owning process, NO_PROCESS if free
+    uint32_t    page;
+    int32_t     prev;
+    int32_t     next;
+    bool        referenced;
+};
+
+//A TLB entry maps (slot, page) to a resident page; slot is NO_PROCESS if unused
+struct tlb_entry {
+    uint32_t        slot;
+    uint32_t        page;
+    unsigned long   last_use;
+};
+
+//State of the paging model during a run
+struct paging_state {
+    bool                        enabled;
+    paging_config               config;
+    std::vector<page_frame>     frames;
+    std::vector<int32_t>        free_frames;
+    int32_t                     head;           //FIFO/LRU list of frames in use
+    int32_t                     tail;
+    std::size_t                 hand;           //Clock
+    std::vector<std::vector<int32_t>> page_tables;  //per slot, frame of each page or -1
+    std::vector<tlb_entry>      tlb;            //small and fully associative, LRU
+    unsigned long               tlb_clock;
+
+    unsigned long               accesses;
+    unsigned long               tlb_hits;
+    unsigned long               faults;
+    unsigned long               evictions;
+};
+
+//io_done value of a request still queued for its device
+const unsigned int IO_NOT_STARTED = UINT32_MAX;
+
+//Slot number used by the queues to mean "no process" (e.g. an idle CPU)
+const uint32_t NO_PROCESS = UINT32_MAX;
+
+//Largest --threads, --workers or --nodes accepted
+const unsigned int MAX_HOST_THREADS = 1024;
+
+//The simulator keeps process state as a structure of arrays: one column per field,
+//indexed by the slot a process was loaded into. The queues only hold slot numbers,
+//so a transition moves a 32-bit index instead of copying a whole PCB, and the main
+//loop only touches the hot columns.
+struct process_table {
+    //hot columns, touched on every event
+    std::vector<states>         state;
+    std::vector<unsigned int>   remaining_time;
+    std::vector<unsigned int>   next_io;        //CPU time left until the next I/O request
+    std::vector<unsigned int>   io_done;        //time at which the current I/O completes
+    std::vector<int>            partition_number;
+    std::vector<unsigned int>   next_access;    //paging: CPU time left until the next memory access
+
+    //cold columns, only read on arrival, dispatch and I/O start
+    std::vector<int>            PID;
+    std::vector<unsigned int>   size;
+    std::vector<unsigned int>   arrival_time;
+    std::vector<int>            start_time;
+    std::vector<unsigned int>   processing_time;
+    std::vector<unsigned int>   io_freq;
+    std::vector<unsigned int>   io_duration;
+    std::vector<unsigned int>   io_device;
+    std::vector<unsigned int>   io_request;     //time the current I/O was requested
+    std::vector<unsigned int>   swap_done;      //time the current swap in/out completes
+    std::vector<unsigned int>   burst;          //paging: CPU bursts started, moves the working set
+    std::vector<unsigned int>   burst_accesses; //paging: accesses made in the current burst
+    std::vector<unsigned int>   working_set;    //paging: pages touched per burst
+    std::vector<uint8_t>        page_fault;     //paging: set while waiting for a page to be read in
+    std::vector<unsigned int>   ready_since;    //time the process last entered the ready queue
+    std::vector<unsigned int>   longest_wait;   //longest stay in the ready queue so far
+
+    //real-time tasks (EDF and RM only)
+    std::vector<unsigned long long> rt_key;     //ready set order, smallest first
+    std::vector<unsigned int>   deadline;       //relative deadline of each job, 0 = none
+    std::vector<unsigned int>   period;
+    std::vector<unsigned int>   job_index;      //job being worked on, counted from 0
+    std::vector<unsigned int>   jobs_released;
+    std::vector<uint8_t>        awaiting_release;   //set while the task has no job to run
+    std::vector<unsigned int>   misses;
+    std::vector<unsigned long>  total_lateness;
+    std::vector<unsigned int>   max_lateness;
+
+    //context switches
+    std::vector<unsigned int>   switch_left;    //CPU time until the switch to this process is done
+    std::vector<unsigned int>   cache_left;     //part of switch_left due to a cold cache, paid last
+    std::vector<unsigned long>  last_busy;      //sim.cpu_busy when it last left the CPU, ULONG_MAX if never ran
+};
+
+//Deadline statistics of a finished real-time task
+struct rt_task_stats {
+    int             PID;
+    unsigned int    period;
+    unsigned int    deadline;
+    unsigned int    jobs;
+    unsigned int    misses;
+    unsigned long   total_lateness;
+    unsigned int    max_lateness;
+};
+
+//Everything a single run of the simulator needs
+struct simulation {
+    process_table           table;
+    std::vector<uint32_t>   arrival_order;  //slots sorted by arrival time
+    std::size_t             next_arrival;   //cursor into arrival_order
+    bool                    whole_workload; //do not stop before the last arrival (sim_config::whole_workload)
+    std::vector<uint32_t>   ready_queue;    //The ready queue of processes
+    std::vector<uint32_t>   wait_queue;     //The wait queue of processes
+    uint32_t                running;        //slot on the CPU, NO_PROCESS if idle
+    unsigned int            current_time;
+    unsigned int            admitted;       //processes given a partition so far
+    unsigned int            terminated;     //processes that have finished so far
+    unsigned long           cpu_busy;       //time the CPU spent running processes
+
+    std::vector<memory_partition>   partitions; //this run's partition table
+    partition_layouts       partition_layout;
+    uint32_t                free_partitions;    //compile-time layouts: bit i is set while partition i + 1 is free
+    std::vector<io_device>  devices;
+
+    //Swapping (medium-term scheduler). Suspended waiting processes stay in the wait
+    //queue so their I/O carries on; once ready they move to suspended_ready until a
+    //partition frees up. swap_queue holds processes whose swap is in progress: a
+    //NEW process waiting for a victim to be swapped out, or a SUSP_READY process
+    //being swapped in.
+    bool                    swapping;
+    unsigned int            swap_out_latency;
+    unsigned int            swap_in_latency;
+    std::vector<uint32_t>   suspended_ready;
+    std::vector<uint32_t>   swap_queue;
+    unsigned long           swap_outs;
+    unsigned long           swap_ins;
+
+    paging_state            paging;
+
+    //Waiting times, for aging and the starvation report
+    unsigned int            starvation_threshold;
+    bool                    wait_report;
+    unsigned long           total_wait;
+    unsigned int            max_wait;
+    int                     max_wait_PID;
+    unsigned int            starved;
+
+    //Real-time scheduling (EDF and RM). The ready queue is then a heap ordered by
+    //rt_key, and the next job release of every periodic task is an event in releases.
+    rt_policies             rt_policy;
+    unsigned int            horizon;
+    std::vector<std::pair<unsigned int, uint32_t>> releases;   //min-heap of (release time, slot)
+    double                  rt_utilization;     //admitted tasks' total density (see task_utilization)
+    unsigned int            rt_tasks;           //admitted tasks with a deadline
+    unsigned int            rt_rejected;        //tasks refused by the schedulability test
+    std::vector<rt_task_stats> rt_stats;
+
+    //Context switch model. cpu_busy only counts useful work; switch_overhead is the
+    //time spent switching.
+    unsigned int            switch_cost;
+    unsigned int            cache_penalty;
+    unsigned int            cache_decay;
+    uint32_t                last_ran;           //last process on the CPU, NO_PROCESS after it terminated or was preempted mid-switch
+    unsigned long           context_switches;
+    unsigned long           switch_overhead;
+    unsigned long           cache_overhead;     //part of switch_overhead due to a cold cache
+
+    //I/O completion interrupts. A finished I/O waits in irq_pending until an interrupt
+    //is raised; the service routine then runs on the CPU for isr_left, holding up the
+    //running process, and makes the processes in irq_service ready when it ends.
+    bool                    interrupts;
+    unsigned int            isr_time;
+    unsigned int            irq_batch;
+    unsigned int            irq_timeout;
+    std::vector<uint32_t>   irq_pending;
+    std::vector<uint32_t>   irq_service;
+    unsigned int            irq_oldest;         //earliest completion time in irq_pending
+    unsigned int            isr_left;
+    unsigned long           interrupts_raised;
+    unsigned long           irq_completions;    //completions delivered
+    unsigned long           isr_busy;           //CPU time spent in service routines
+    unsigned long           irq_latency;        //total time from completion to delivery
+    unsigned int            max_irq_latency;
+    unsigned int            slice_left;     //RR: time left in the running process's quantum
+
+    //Streaming mode only: arrivals are read one ahead from arrival_stream, and the
+    //slots of terminated processes are reused so the table holds live processes only
+    std::istream*           arrival_stream;
+    std::string             arrival_line;
+    PCB                     next_process;
+    bool                    have_next_process;
+    std::vector<uint32_t>   free_slots;
+
+    std::string             execution_status;
+    std::string             memory_log;
+    std::ostream*           execution_sink; //if set, output is written out as the run goes
+    std::ostream*           memory_sink;
+
+    std::size_t             loop_allocations; //allocation_count when the loop started
+    bool                    exit_on_allocations;
 };
 
 //------------------------------------HELPER FUNCTIONS FOR THE SIMULATOR------------------------------
 // Following function was taken from stackoverflow; helper function for splitting strings
-std::vector<std::string> split_delim(std::string input, std::string delim) {
+std::vector<std::string> split_delim(const std::string &input, const std::string &delim) {
     std::vector<std::string> tokens;
+    std::size_t start = 0;
     std::size_t pos = 0;
-    std::string token;
-    while ((pos = input.find(delim)) != std::string::npos) {
-        token = input.substr(0, pos);
-        tokens.push_back(token);
-        input.erase(0, pos + delim.length());
+    while ((pos = input.find(delim, start)) != std::string::npos) {
+        tokens.emplace_back(input, start, pos - start);
+        start = pos + delim.length();
     }
-    tokens.push_back(input);
+    tokens.emplace_back(input, start);
 
     return tokens;
 }
 
+//Parse a whole non-negative number no larger than max. Throws std::invalid_argument for
+//a sign, trailing characters or a value out of range, where std::stoi would wrap.
+unsigned int parse_unsigned(const std::string &value, unsigned long max = UINT_MAX) {
+    if (value.empty() || value[0] < '0' || value[0] > '9') {
+        throw std::invalid_argument(value);
+    }
+    std::size_t used = 0;
+    unsigned long number = std::stoul(value, &used);
+    if (used != value.size() || number > max) {
+        throw std::invalid_argument(value);
+    }
+    return number;
+}
+
 //Function that takes a queue as an input and outputs a string table of PCBs
 std::string print_PCB(std::vector<PCB> _PCB) {
     const int tableWidth = 83;
@@ -114,21 +891,17 @@ std::string print_PCB(std::vector<PCB> _PCB) {
     
     // Print each PCB entry
     for (const auto& program : _PCB) {
-        buffer << "|"
-                  << std::setfill(' ') << std::setw(4) << program.PID
-                  << std::setw(2) << "|"
-                  << std::setw(11) << program.partition_number
-                  << std::setw(2) << "|"
-                  << std::setw(5) << program.size
-                  << std::setw(2) << "|"
-                  << std::setw(13) << program.arrival_time
-                  << std::setw(2) << "|"
-                  << std::setw(11) << program.start_time
-                  << std::setw(2) << "|"
-                  << std::setw(14) << program.remaining_time
-                  << std::setw(2) << "|"
-                  << std::setw(11) << program.state
-                  << std::setw(2) << "|" << std::endl;
+        char row[160];
+        row_writer writer{row};
+        writer.text("|").field<4>(program.PID)
+              .text(" |").field<11>(program.partition_number)
+              .text(" |").field<5>(program.size)
+              .text(" |").field<13>(program.arrival_time)
+              .text(" |").field<11>(program.start_time)
+              .text(" |").field<14>(program.remaining_time)
+              .text(" |").state<11>(program.state)
+              .text(" |\n");
+        buffer.write(row, writer.out - row);
     }
     
     // Print bottom border
@@ -171,23 +944,18 @@ std::string print_exec_header() {
 
 }
 
-std::string print_exec_status(unsigned int current_time, int PID, states old_state, states new_state) {
-
-    const int tableWidth = 49;
-
-    std::stringstream buffer;
-
-    buffer  << "|"
-            << std::setfill(' ') << std::setw(18) << current_time
-            << std::setw(2) << "|"
-            << std::setw(3) << PID
-            << std::setw(2) << "|"
-            << std::setw(10) << old_state
-            << std::setw(2) << "|"
-            << std::setw(10) << new_state
-            << std::setw(2) << "|" << std::endl;
-
-    return buffer.str();
+//Appends one row of the execution table. Rows are formatted on the stack, so this
+//does not allocate as long as execution_status has enough capacity reserved.
+void print_exec_status(std::string &execution_status, unsigned int current_time, int PID, states old_state, states new_state) {
+    PROFILE_LOG_SCOPE();
+    char row[96];
+    row_writer writer{row};
+    writer.text("|").field<18>(current_time)
+          .text(" |").field<3>(PID)
+          .text(" |").state<10>(old_state)
+          .text(" |").state<10>(new_state)
+          .text(" |\n");
+    execution_status.append(row, writer.out - row);
 }
 
 std::string print_exec_footer() {
@@ -200,13 +968,226 @@ std::string print_exec_footer() {
     return buffer.str();
 }
 
-//Synchronize the process in the process queue
-void sync_queue(std::vector<PCB> &process_queue, PCB _process) {
-    for(auto &process : process_queue) {
-        if(process.PID == _process.PID) {
-            process = _process;
+//Parse one "--name=value" option. Returns false with a description in error if it
+//is not understood.
+bool parse_option(const std::string &option, sim_config &config, std::string &error) {
+    std::size_t equals = option.find('=');
+    std::string name = option.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+
+    try {
+        if (name == "--stream") {
+            config.stream = true;
+        } else if (name == "--batch") {
+            config.batch = true;
+        } else if (name == "--io-device") {
+            //--io-device=<concurrency>[:fifo|:priority]
+            auto fields = split_delim(value, ":");
+            io_device_config device;
+            device.concurrency = parse_unsigned(fields[0]);
+            device.discipline = IO_FIFO;
+            if (fields.size() > 1 && fields[1] == "priority") {
+                device.discipline = IO_PRIORITY;
+            } else if (fields.size() > 1 && fields[1] != "fifo") {
+                throw std::invalid_argument(fields[1]);
+            }
+            if (device.concurrency == 0) {
+                throw std::invalid_argument(value);
+            }
+            config.io_devices.push_back(device);
+        } else if (name == "--swap") {
+            //--swap=<swap-out latency>[:<swap-in latency>]
+            auto fields = split_delim(value, ":");
+            config.swapping = true;
+            config.swap_out_latency = parse_unsigned(fields[0]);
+            config.swap_in_latency = fields.size() > 1 ? parse_unsigned(fields[1]) : config.swap_out_latency;
+        } else if (name == "--paging") {
+            //--paging=<frames>:<page size>:<fifo|lru|clock>[:<tlb entries>[:<fault latency>[:<access interval>]]]
+            auto fields = split_delim(value, ":");
+            paging_config &paging = config.paging_options;
+            if (fields.size() < 3) {
+                throw std::invalid_argument(value);
+            }
+            paging.frames = parse_unsigned(fields[0]);
+            paging.page_size = parse_unsigned(fields[1]);
+            if (fields[2] == "fifo") {
+                paging.policy = REPLACE_FIFO;
+            } else if (fields[2] == "lru") {
+                paging.policy = REPLACE_LRU;
+            } else if (fields[2] == "clock") {
+                paging.policy = REPLACE_CLOCK;
+            } else {
+                throw std::invalid_argument(fields[2]);
+            }
+            paging.tlb_entries = fields.size() > 3 ? parse_unsigned(fields[3]) : 16;
+            paging.fault_latency = fields.size() > 4 ? parse_unsigned(fields[4]) : 10;
+            paging.access_interval = fields.size() > 5 ? parse_unsigned(fields[5]) : 5;
+            if (paging.frames == 0 || paging.page_size == 0 || paging.access_interval == 0) {
+                throw std::invalid_argument(value);
+            }
+            config.paging = true;
+        } else if (name == "--nodes") {
+            //--nodes=<count>[:rr|:least|:fit]
+            auto fields = split_delim(value, ":");
+            config.nodes = parse_unsigned(fields[0], MAX_HOST_THREADS);
+            config.placement = PLACE_ROUND_ROBIN;
+            if (fields.size() > 1 && fields[1] == "least") {
+                config.placement = PLACE_LEAST_LOADED;
+            } else if (fields.size() > 1 && fields[1] == "fit") {
+                config.placement = PLACE_BEST_FIT;
+            } else if (fields.size() > 1 && fields[1] != "rr") {
+                throw std::invalid_argument(fields[1]);
+            }
+            if (config.nodes == 0) {
+                throw std::invalid_argument(value);
+            }
+        } else if (name == "--threads") {
+            config.threads = parse_unsigned(value, MAX_HOST_THREADS);
+        } else if (name == "--migrate") {
+            //--migrate=<latency>[:<time per unit of size>]
+            auto fields = split_delim(value, ":");
+            config.migration = true;
+            config.migration_latency = parse_unsigned(fields[0]);
+            config.migration_per_unit = fields.size() > 1 ? parse_unsigned(fields[1]) : 0;
+        } else if (name == "--context-switch") {
+            //--context-switch=<cost>[:<cache penalty>[:<cache decay>]]
+            auto fields = split_delim(value, ":");
+            config.switch_cost = parse_unsigned(fields[0]);
+            config.cache_penalty = fields.size() > 1 ? parse_unsigned(fields[1]) : 0;
+            config.cache_decay = fields.size() > 2 ? parse_unsigned(fields[2]) : 100;
+            if (config.cache_decay == 0) {
+                throw std::invalid_argument(value);
+            }
+        } else if (name == "--interrupts") {
+            //--interrupts=<ISR time>[:<batch>[:<timeout>]], batching waits 10 ms by default
+            auto fields = split_delim(value, ":");
+            config.interrupts = true;
+            config.isr_time = parse_unsigned(fields[0]);
+            config.irq_batch = fields.size() > 1 ? parse_unsigned(fields[1]) : 1;
+            config.irq_timeout = fields.size() > 2 ? parse_unsigned(fields[2]) : 10;
+            if (config.irq_batch == 0) {
+                throw std::invalid_argument(value);
+            }
+        } else if (name == "--aging") {
+            config.aging = parse_unsigned(value);
+            config.wait_report = true;
+        } else if (name == "--starvation") {
+            config.starvation_threshold = parse_unsigned(value);
+            config.wait_report = true;
+        } else if (name == "--policy") {
+            config.policy = value;
+        } else if (name == "--horizon") {
+            config.horizon = parse_unsigned(value);
+        } else if (name == "--quantum") {
+            config.quantum = parse_unsigned(value);
+            if (config.quantum == 0) {
+                throw std::invalid_argument(value);
+            }
+        } else if (name == "--partitions") {
+            //--partitions=<size>,<size>,... numbered from 1 in order
+            config.partition_sizes.clear();
+            for (const auto &size : split_delim(value, ",")) {
+                config.partition_sizes.push_back(parse_unsigned(size));
+            }
+        } else if (name == "--serve") {
+            config.serve_path = value;
+        } else if (name == "--workers") {
+            config.workers = parse_unsigned(value, MAX_HOST_THREADS);
+        } else {
+            error = "Unknown option: " + option;
+            return false;
+        }
+    } catch (const std::exception &) {
+        error = "Bad value for option: " + option;
+        return false;
+    }
+    return true;
+}
+
+//Check that the options given can be used together, and with the policy of this binary
+bool check_config(const sim_config &config, const char* policy, std::string &error) {
+    if (config.aging > 0 && std::string(policy) != "EP" && std::string(policy) != "EP_RR") {
+        error = "--aging only applies to EP and EP_RR";
+        return false;
+    }
+    if (config.paging && config.swapping) {
+        error = "--paging and --swap cannot be used together";
+        return false;
+    }
+    if (config.nodes > 0 && (config.stream || !config.serve_path.empty())) {
+        error = "--nodes cannot be used with --stream or --serve";
+        return false;
+    }
+    if (config.batch && (config.stream || !config.serve_path.empty() || config.nodes > 0)) {
+        error = "--batch cannot be used with --stream, --serve or --nodes";
+        return false;
+    }
+    if (config.migration && config.nodes == 0) {
+        error = "--migrate needs --nodes";
+        return false;
+    }
+    return true;
+}
+
+//Parse the command line: the input file and any "--name=value" options. Prints the
+//problem and returns false if something is not understood. policy is the scheduler
+//this binary implements; a different --policy is an error.
+bool parse_options(int argc, char** argv, sim_config &config, const char* policy) {
+    std::string error;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument.rfind("--", 0) != 0) {
+            if (!config.input_file.empty()) {
+                std::cerr << "Error: More than one input file given" << std::endl;
+                return false;
+            }
+            config.input_file = argument;
+        } else if (!parse_option(argument, config, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return false;
         }
     }
+    if (!check_config(config, policy, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return false;
+    }
+    if (!config.policy.empty() && config.policy != policy) {
+        std::cerr << "Error: This is the " << policy << " scheduler, not " << config.policy << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//Lists the options understood by parse_options()
+void print_options() {
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --io-device=<concurrency>[:fifo|:priority]  add an I/O device (numbered from 1 in order)" << std::endl;
+    std::cout << "  --stream                                    read arrivals as the simulation reaches them;" << std::endl;
+    std::cout << "                                              the input file may be a FIFO, or - for stdin" << std::endl;
+    std::cout << "  --swap=<out ms>[:<in ms>]                   swap processes out when memory is full" << std::endl;
+    std::cout << "  --paging=<frames>:<page size>:<fifo|lru|clock>[:<TLB entries>[:<fault ms>[:<access interval ms>]]]" << std::endl;
+    std::cout << "                                              paged memory instead of partitions (defaults 16:10:5)" << std::endl;
+    std::cout << "  --context-switch=<ms>[:<cache ms>[:<decay ms>]]" << std::endl;
+    std::cout << "                                              cost of a dispatch, plus up to <cache ms> for a process" << std::endl;
+    std::cout << "                                              whose cache others have used for <decay ms> (default 100)" << std::endl;
+    std::cout << "  --interrupts=<ms>[:<batch>[:<timeout ms>]]" << std::endl;
+    std::cout << "                                              deliver I/O completions by an interrupt whose handler takes" << std::endl;
+    std::cout << "                                              <ms> of CPU, coalescing up to <batch> completions for at" << std::endl;
+    std::cout << "                                              most <timeout ms> (default 10)" << std::endl;
+    std::cout << "  --aging=<ms>                                EP: raise a waiting process one priority level per <ms>" << std::endl;
+    std::cout << "  --starvation=<ms>                           report processes that waited longer (default 1000)" << std::endl;
+    std::cout << "  --quantum=<ms>                              time slice of RR and EP_RR (default 100)" << std::endl;
+    std::cout << "  --horizon=<ms>                              EDF and RM: end of periodic job releases (default 1000)" << std::endl;
+    std::cout << "  --partitions=<size>,<size>,...              memory partition sizes (default 40,25,15,10,8,2)" << std::endl;
+    std::cout << "  --nodes=<count>[:rr|:least|:fit]            simulate a cluster, placing arrivals on nodes" << std::endl;
+    std::cout << "  --migrate=<ms>[:<ms per unit of size>]      move arrivals that would not fit to another node" << std::endl;
+    std::cout << "  --batch                                     the input file lists workload files, one per line, to run" << std::endl;
+    std::cout << "                                              with the same options (metrics per workload in batch.txt)" << std::endl;
+    std::cout << "  --threads=<n>                               host threads running cluster nodes or batch workloads" << std::endl;
+    std::cout << "                                              (default 1, 0 for one per core)" << std::endl;
+    std::cout << "  --policy=<EP|RR|EP_RR|EDF|RM>               check that this binary runs the expected policy" << std::endl;
+    std::cout << "  --serve=<socket path>                       run as a simulation server instead (no input file)" << std::endl;
+    std::cout << "  --workers=<n>                               server worker threads (default one per core)" << std::endl;
 }
 
 //Writes a string to a file
@@ -224,19 +1205,88 @@ void write_output(std::string execution, const char* filename) {
     std::cout << "Output generated in " << filename << ".txt" << std::endl;
 }
 
+//Size in bytes of one logMemoryStatus() entry, used to reserve the memory log
+std::size_t memory_log_entry_size(std::size_t num_partitions) {
+    return 25 + 44 + 44 + 45 + 43 * num_partitions;
+}
+
+void logMemoryStatus(std::string &memory_log, const std::vector<memory_partition> &partitions) {
+    PROFILE_LOG_SCOPE();
+    memory_log += "Memory Partition Status:\n";
+    memory_log += "Partition Number | Size | Occupied By (PID)\n";
+    memory_log += "-------------------------------------------\n";
+    for (const auto& partition : partitions) {
+        char row[96];
+        row_writer writer{row};
+        writer.field<16>(partition.partition_number).text(" | ").field<4>(partition.size).text(" | ");
+        if (partition.occupied == -1) {
+            writer.field<16>("Free");
+        } else {
+            writer.field<16>(partition.occupied);
+        }
+        writer.text("\n");
+        memory_log.append(row, writer.out - row);
+    }
+    memory_log += "-------------------------------------------\n\n";
+}
+
+//Size in bytes of one logFrameStatus() entry, used to reserve the memory log
+std::size_t frame_log_entry_size(std::size_t num_frames) {
+    return 14 + 37 + 37 + 38 + 37 * num_frames;
+}
+
+//Paging mode's counterpart of logMemoryStatus(): the page held by every frame
+void logFrameStatus(std::string &memory_log, const paging_state &paging, const std::vector<int> &PIDs) {
+    PROFILE_LOG_SCOPE();
+    memory_log += "Frame Status:\n";
+    memory_log += "Frame Number | Page | Owned By (PID)\n";
+    memory_log += "------------------------------------\n";
+    for (std::size_t f = 0; f < paging.frames.size(); f++) {
+        const page_frame &frame = paging.frames[f];
+        char row[96];
+        row_writer writer{row};
+        writer.field<12>(f + 1).text(" | ");
+        if (frame.slot == NO_PROCESS) {
+            writer.field<4>("-").text(" | ").field<14>("Free");
+        } else {
+            writer.field<4>(frame.page).text(" | ").field<14>(PIDs[frame.slot]);
+        }
+        writer.text("\n");
+        memory_log.append(row, writer.out - row);
+    }
+    memory_log += "------------------------------------\n\n";
+}
+
+//Longest line logSwap() can write, used to reserve the memory log
+const std::size_t swap_log_line_size = 80;
+
+//Records a swap in the memory log; the memory status after it follows
+void logSwap(std::string &memory_log, bool swap_in, int PID, int partition_number, unsigned int current_time) {
+    PROFILE_LOG_SCOPE();
+    char row[96];
+    row_writer writer{row};
+    if (swap_in) {
+        writer.text("Swap in: PID ");
+    } else {
+        writer.text("Swap out: PID ");
+    }
+    writer.field<1>(PID).text(" partition ").field<1>(partition_number)
+          .text(" at time ").field<1>(current_time).text("\n");
+    memory_log.append(row, writer.out - row);
+}
+
 //--------------------------------------------FUNCTIONS FOR THE "OS"-------------------------------------
 
-//Assign memory partition to program
-bool assign_memory(PCB &program) {
-    int size_to_fit = program.size;
-    int available_size = 0;
 
-    for(int i = 5; i >= 0; i--) {
-        available_size = memory_paritions[i].size;
+//Assign memory partition to program. Partitions are tried from the last to the
+//first, so with the default layout the smallest free partition that fits is used.
+bool assign_memory(std::vector<memory_partition> &partitions, process_table &table, uint32_t slot) {
+    unsigned int size_to_fit = table.size[slot];
 
-        if(size_to_fit <= available_size && memory_paritions[i].occupied == -1) {
-            memory_paritions[i].occupied = program.PID;
-            program.partition_number = memory_paritions[i].partition_number;
+    for(int i = (int)partitions.size() - 1; i >= 0; i--) {
+        if(size_to_fit <= partitions[i].size && partitions[i].occupied == -1) {
+            partitions[i].occupied = table.PID[slot];
+            table.partition_number[slot] = partitions[i].partition_number;
             return true;
         }
     }
@@ -245,17 +1295,74 @@ bool assign_memory(PCB &program) {
 }
 
 //Free a memory partition
-bool free_memory(PCB &program){
-    for(int i = 5; i >= 0; i--) {
-        if(program.PID == memory_paritions[i].occupied) {
-            memory_paritions[i].occupied = -1;
-            program.partition_number = -1;
+bool free_memory(std::vector<memory_partition> &partitions, process_table &table, uint32_t slot) {
+    for(int i = (int)partitions.size() - 1; i >= 0; i--) {
+        if(table.PID[slot] == partitions[i].occupied) {
+            partitions[i].occupied = -1;
+            table.partition_number[slot] = -1;
             return true;
         }
     }
     return false;
 }
 
+//Fit search for a partition layout fixed at compile time. The partitions big enough
+//for a size come from comparisons against the constant sizes, unrolled into one
+//bitmask; ANDed with the free partitions, the highest set bit is the partition the
+//generic scan from the last partition would pick.
+template <const auto &sizes>
+struct fixed_partitions {
+    static_assert(sizes.size() <= 32, "occupancy is tracked in a 32-bit word");
+
+    static uint32_t fitting(unsigned int size) {
+        return fitting(size, std::make_index_sequence<sizes.size()>());
+    }
+
+    template <std::size_t... i>
+    static uint32_t fitting(unsigned int size, std::index_sequence<i...>) {
+        return ((uint32_t(size <= sizes[i]) << i) | ...);
+    }
+
+    static bool assign(simulation &sim, uint32_t slot) {
+        uint32_t candidates = fitting(sim.table.size[slot]) & sim.free_partitions;
+        if (candidates == 0) {
+            return false;
+        }
+        unsigned int i = 31 - __builtin_clz(candidates);
+        sim.free_partitions &= ~(1u << i);
+        sim.partitions[i].occupied = sim.table.PID[slot];
+        sim.table.partition_number[slot] = i + 1;
+        return true;
+    }
+
+    static bool release(simulation &sim, uint32_t slot) {
+        int partition = sim.table.partition_number[slot];
+        if (partition <= 0) {
+            return false;
+        }
+        sim.free_partitions |= 1u << (partition - 1);
+        sim.partitions[partition - 1].occupied = -1;
+        sim.table.partition_number[slot] = -1;
+        return true;
+    }
+};
+
+//Give slot a partition, with the fit search of this run's layout
+bool assign_partition(simulation &sim, uint32_t slot) {
+    if (sim.partition_layout == LAYOUT_DEFAULT) {
+        return fixed_partitions<default_partition_sizes>::assign(sim, slot);
+    }
+    return assign_memory(sim.partitions, sim.table, slot);
+}
+
+//Free slot's partition
+bool free_partition(simulation &sim, uint32_t slot) {
+    if (sim.partition_layout == LAYOUT_DEFAULT) {
+        return fixed_partitions<default_partition_sizes>::release(sim, slot);
+    }
+    return free_memory(sim.partitions, sim.table, slot);
+}
+
 //Convert a list of strings into a PCB
 PCB add_process(std::vector<std::string> tokens) {
     PCB process;
@@ -266,6 +1373,9 @@ PCB add_process(std::vector<std::string> tokens) {
     process.remaining_time = std::stoi(tokens[3]);
     process.io_freq = std::stoi(tokens[4]);
     process.io_duration = std::stoi(tokens[5]);
+    process.io_device = tokens.size() > 6 ? std::stoi(tokens[6]) : 0;
+    process.deadline = tokens.size() > 7 ? std::stoi(tokens[7]) : 0;
+    process.period = tokens.size() > 8 ? std::stoi(tokens[8]) : 0;
     process.start_time = -1;
     process.partition_number = -1;
     process.state = NOT_ASSIGNED;
@@ -273,68 +1383,2526 @@ PCB add_process(std::vector<std::string> tokens) {
     return process;
 }
 
-//Returns true if all processes in the queue have terminated
-bool all_process_terminated(std::vector<PCB> processes) {
-
-    for(auto process : processes) {
-        if(process.state != TERMINATED) {
-            return false;
-        }
-    }
+//Overwrite a slot of the process table with a PCB
+void store_process(process_table &table, uint32_t slot, const PCB &process) {
+    table.state[slot] = process.state;
+    table.remaining_time[slot] = process.remaining_time;
+    table.next_io[slot] = process.io_freq;
+    table.io_done[slot] = 0;
+    table.partition_number[slot] = process.partition_number;
+    table.next_access[slot] = 0;
 
-    return true;
+    table.PID[slot] = process.PID;
+    table.size[slot] = process.size;
+    table.arrival_time[slot] = process.arrival_time;
+    table.start_time[slot] = process.start_time;
+    table.processing_time[slot] = process.processing_time;
+    table.io_freq[slot] = process.io_freq;
+    table.io_duration[slot] = process.io_duration;
+    table.io_device[slot] = process.io_device;
+    table.io_request[slot] = 0;
+    table.swap_done[slot] = 0;
+    table.burst[slot] = 0;
+    table.burst_accesses[slot] = 0;
+    table.working_set[slot] = 0;
+    table.page_fault[slot] = 0;
+    table.ready_since[slot] = 0;
+    table.longest_wait[slot] = 0;
+    table.rt_key[slot] = 0;
+    table.deadline[slot] = process.deadline > 0 ? process.deadline : process.period;
+    table.period[slot] = process.period;
+    table.job_index[slot] = 0;
+    table.jobs_released[slot] = 0;
+    table.awaiting_release[slot] = 0;
+    table.misses[slot] = 0;
+    table.total_lateness[slot] = 0;
+    table.max_lateness[slot] = 0;
+    table.switch_left[slot] = 0;
+    table.cache_left[slot] = 0;
+    table.last_busy[slot] = ULONG_MAX;
 }
 
-//Terminates a given process
-void terminate_process(PCB &running, std::vector<PCB> &job_queue) {
-    running.remaining_time = 0;
-    running.state = TERMINATED;
-    free_memory(running);
-    sync_queue(job_queue, running);
-}
+//Append a PCB to the process table and return the slot it was given
+uint32_t load_process(process_table &table, const PCB &process) {
+    uint32_t slot = table.PID.size();
 
-//set the process in the ready queue to runnning
-void run_process(PCB &running, std::vector<PCB> &job_queue, std::vector<PCB> &ready_queue, unsigned int current_time) {
-    running = ready_queue.back();
-    ready_queue.pop_back();
-    running.start_time = current_time;
-    running.state = RUNNING;
-    sync_queue(job_queue, running);
-}
+    table.state.push_back(process.state);
+    table.remaining_time.push_back(process.remaining_time);
+    table.next_io.push_back(process.io_freq);
+    table.io_done.push_back(0);
+    table.partition_number.push_back(process.partition_number);
+    table.next_access.push_back(0);
 
-void idle_CPU(PCB &running) {
-    running.start_time = 0;
-    running.processing_time = 0;
-    running.remaining_time = 0;
-    running.arrival_time = 0;
-    running.io_duration = 0;
-    running.io_freq = 0;
-    running.partition_number = 0;
-    running.size = 0;
-    running.state = NOT_ASSIGNED;
-    running.PID = -1;
-}
+    table.PID.push_back(process.PID);
+    table.size.push_back(process.size);
+    table.arrival_time.push_back(process.arrival_time);
+    table.start_time.push_back(process.start_time);
+    table.processing_time.push_back(process.processing_time);
+    table.io_freq.push_back(process.io_freq);
+    table.io_duration.push_back(process.io_duration);
+    table.io_device.push_back(process.io_device);
+    table.io_request.push_back(0);
+    table.swap_done.push_back(0);
+    table.burst.push_back(0);
+    table.burst_accesses.push_back(0);
+    table.working_set.push_back(0);
+    table.page_fault.push_back(0);
+    table.ready_since.push_back(0);
+    table.longest_wait.push_back(0);
+    table.rt_key.push_back(0);
+    table.deadline.push_back(process.deadline > 0 ? process.deadline : process.period);
+    table.period.push_back(process.period);
+    table.job_index.push_back(0);
+    table.jobs_released.push_back(0);
+    table.awaiting_release.push_back(0);
+    table.misses.push_back(0);
+    table.total_lateness.push_back(0);
+    table.max_lateness.push_back(0);
+    table.switch_left.push_back(0);
+    table.cache_left.push_back(0);
+    table.last_busy.push_back(ULONG_MAX);
 
+    return slot;
+}
 
+//Rebuild a PCB from the process table (for print_PCB and debugging)
+PCB get_PCB(const process_table &table, uint32_t slot) {
+    PCB process;
+    process.PID = table.PID[slot];
+    process.size = table.size[slot];
+    process.arrival_time = table.arrival_time[slot];
+    process.start_time = table.start_time[slot];
+    process.processing_time = table.processing_time[slot];
+    process.remaining_time = table.remaining_time[slot];
+    process.partition_number = table.partition_number[slot];
+    process.state = table.state[slot];
+    process.io_freq = table.io_freq[slot];
+    process.io_duration = table.io_duration[slot];
+    process.io_device = table.io_device[slot];
+    process.deadline = table.deadline[slot];
+    process.period = table.period[slot];
 
+    return process;
+}
 
+//Upper bound on the number of execution table rows a process can produce: one for
+//its arrival, two per CPU burst (dispatch and end of burst) and one per I/O completion.
+//quantum is the time slice of the policy, or 0 if it never preempts.
+std::size_t max_exec_rows(const PCB &process, unsigned int quantum) {
+    std::size_t io_count = 0;
+    std::size_t preemptions = 0;
+    if (process.processing_time > 0 && process.io_freq > 0) {
+        io_count = (process.processing_time - 1) / process.io_freq;
+    }
+    if (process.processing_time > 0 && quantum > 0) {
+        preemptions = (process.processing_time - 1) / quantum;
+    }
+    std::size_t bursts = 1 + io_count + preemptions;
+    return 1 + 2 * bursts + io_count;
+}
 
+//rows += count * each, saturating instead of wrapping around for absurd workloads
+void add_rows(std::size_t &rows, std::size_t count, std::size_t each) {
+    std::size_t product;
+    if (__builtin_mul_overflow(count, each, &product) || __builtin_add_overflow(rows, product, &rows)) {
+        rows = SIZE_MAX;
+    }
+}
 
-void ExternalPriority(std::vector<PCB>& ready_queue) {
-    std::sort(ready_queue.begin(), ready_queue.end(), [](const PCB& a, const PCB& b) {
-        return a.PID < b.PID;
-    });
+//Empty every column of the process table, keeping the memory allocated
+void clear_table(process_table &table) {
+    table.state.clear();
+    table.remaining_time.clear();
+    table.next_io.clear();
+    table.io_done.clear();
+    table.partition_number.clear();
+    table.next_access.clear();
+    table.PID.clear();
+    table.size.clear();
+    table.arrival_time.clear();
+    table.start_time.clear();
+    table.processing_time.clear();
+    table.io_freq.clear();
+    table.io_duration.clear();
+    table.io_device.clear();
+    table.io_request.clear();
+    table.swap_done.clear();
+    table.burst.clear();
+    table.burst_accesses.clear();
+    table.working_set.clear();
+    table.page_fault.clear();
+    table.ready_since.clear();
+    table.longest_wait.clear();
+    table.rt_key.clear();
+    table.deadline.clear();
+    table.period.clear();
+    table.job_index.clear();
+    table.jobs_released.clear();
+    table.awaiting_release.clear();
+    table.misses.clear();
+    table.total_lateness.clear();
+    table.max_lateness.clear();
+    table.switch_left.clear();
+    table.cache_left.clear();
+    table.last_busy.clear();
 }
 
-void logMemoryStatus(std::ostream& os) {
-    os << "Memory Partition Status:\n";
-    os << "Partition Number | Size | Occupied By (PID)\n";
-    os << "-------------------------------------------\n";
-    for (const auto& partition : memory_paritions) {
-        os << std::setw(16) << partition.partition_number << " | "
-           << std::setw(4) << partition.size << " | "
-           << std::setw(16) << (partition.occupied == -1 ? "Free" : std::to_string(partition.occupied)) << "\n";
+//Build the partition table a run starts with: the default layout, or --partitions.
+//Returns the compile-time layout it matches, if any.
+partition_layouts make_partitions(const sim_config &config, std::vector<memory_partition> &partitions) {
+    partitions.clear();
+    if (config.partition_sizes.empty()) {
+        for (std::size_t i = 0; i < default_partition_sizes.size(); i++) {
+            partitions.push_back({(unsigned int)i + 1, default_partition_sizes[i], -1});
+        }
+        return LAYOUT_DEFAULT;
     }
-    os << "-------------------------------------------\n\n";
-}
+
+    for (std::size_t i = 0; i < config.partition_sizes.size(); i++) {
+        partitions.push_back({(unsigned int)i + 1, config.partition_sizes[i], -1});
+    }
+    if (std::equal(config.partition_sizes.begin(), config.partition_sizes.end(),
+                   default_partition_sizes.begin(), default_partition_sizes.end())) {
+        return LAYOUT_DEFAULT;
+    }
+    return LAYOUT_GENERIC;
+}
+
+//Number of pages a process of the given size needs
+unsigned int page_count(const paging_config &config, unsigned int size) {
+    return std::max(1u, (size + config.page_size - 1) / config.page_size);
+}
+
+//Number of jobs a periodic task releases before horizon; 1 for a one-shot task
+std::size_t released_jobs(const PCB &process, unsigned int horizon) {
+    if (process.period == 0 || process.arrival_time >= horizon) {
+        return 1;
+    }
+    return (horizon - process.arrival_time + process.period - 1) / process.period;
+}
+
+//Upper bound on the memory accesses a process makes: one every access_interval of
+//CPU time, plus the one at the start of its first dispatch
+std::size_t max_page_accesses(const PCB &process, const paging_config &config) {
+    return 1 + process.processing_time / config.access_interval;
+}
+
+//Set up the frames and TLB for a run. Frames start on the free list in order.
+void init_paging(paging_state &paging, const sim_config &config) {
+    paging.enabled = config.paging;
+    paging.config = config.paging_options;
+    paging.frames.clear();
+    paging.free_frames.clear();
+    paging.tlb.clear();
+    paging.head = -1;
+    paging.tail = -1;
+    paging.hand = 0;
+    paging.tlb_clock = 0;
+    paging.accesses = 0;
+    paging.tlb_hits = 0;
+    paging.faults = 0;
+    paging.evictions = 0;
+    if (!paging.enabled) {
+        return;
+    }
+
+    paging.frames.assign(paging.config.frames, {NO_PROCESS, 0, -1, -1, false});
+    for (int32_t f = paging.config.frames - 1; f >= 0; f--) {
+        paging.free_frames.push_back(f);
+    }
+    paging.tlb.assign(paging.config.tlb_entries, {NO_PROCESS, 0, 0});
+}
+
+//Each thread reuses one simulation, so the buffers sized by earlier runs stay warm
+//and a later run of similar size does not have to allocate them again
+simulation& thread_simulation() {
+    thread_local simulation sim;
+    return sim;
+}
+
+//Load the whole workload and prepare an empty run. Every buffer the loop writes to
+//is sized from the workload here, so the loop itself does not allocate. sim may hold
+//a previous run; its buffers are cleared but keep their capacity.
+void init_simulation(simulation &sim, const std::vector<PCB> &list_processes, const sim_config &config,
+                     unsigned int quantum = 0, rt_policies rt_policy = RT_NONE) {
+    clear_table(sim.table);
+    sim.arrival_order.clear();
+    sim.ready_queue.clear();
+    sim.wait_queue.clear();
+    sim.free_slots.clear();
+    sim.suspended_ready.clear();
+    sim.swap_queue.clear();
+    sim.releases.clear();
+    sim.rt_stats.clear();
+    sim.devices.clear();
+    sim.execution_status.clear();
+    sim.memory_log.clear();
+
+    sim.partition_layout = make_partitions(config, sim.partitions);
+    sim.free_partitions = sim.partition_layout == LAYOUT_GENERIC ? 0 : (uint32_t)((1ull << sim.partitions.size()) - 1);
+
+    const std::size_t row_capacity = 64; //a row is 51 bytes unless PID or time overflow their columns
+    std::size_t rows = 2;                 //header and footer
+    for(const auto &process : list_processes) {
+        add_rows(rows, 1, max_exec_rows(process, quantum));
+    }
+    //each arrival can suspend one process, which adds up to three rows
+    //(suspended, I/O done while suspended, swapped back in) and two log entries
+    std::size_t memory_entries = 2 * list_processes.size();
+    if (config.swapping) {
+        rows += 3 * list_processes.size();
+        memory_entries += 2 * list_processes.size();
+    }
+    //every job of a periodic task runs like a process of its own, plus a release row
+    //and the preemption its release can cause
+    if (rt_policy != RT_NONE) {
+        for(const auto &process : list_processes) {
+            add_rows(rows, released_jobs(process, config.horizon), max_exec_rows(process, 0) + 3);
+        }
+    }
+    //a page fault adds three rows (blocked, page read in, dispatched again), and every
+    //job of a periodic task makes its own accesses
+    if (config.paging) {
+        for(const auto &process : list_processes) {
+            std::size_t jobs = rt_policy != RT_NONE ? released_jobs(process, config.horizon) : 1;
+            std::size_t faults = 0;
+            add_rows(faults, jobs, max_page_accesses(process, config.paging_options));
+            add_rows(rows, 3, faults);
+        }
+    }
+    std::size_t memory_entry_size = memory_log_entry_size(sim.partitions.size()) + swap_log_line_size;
+    if (config.paging) {
+        memory_entry_size = frame_log_entry_size(config.paging_options.frames);
+    }
+
+    //a context switch adds a row to every dispatch, and every dispatch has a row
+    //ending its burst
+    if (config.switch_cost > 0 || config.cache_penalty > 0) {
+        add_rows(rows, 1, rows / 2 + 1);
+    }
+
+    std::size_t execution_size = 0;
+    add_rows(execution_size, rows, row_capacity);
+    std::size_t memory_size = 0;
+    add_rows(memory_size, memory_entries, memory_entry_size);
+
+    //a server refuses a workload whose logs would not fit its limit up front
+    std::size_t log_size = execution_size;
+    add_rows(log_size, 1, memory_size);
+    if (config.max_log_size > 0 && log_size > config.max_log_size) {
+        throw std::length_error("Workload needs more than " + std::to_string(config.max_log_size) + " bytes of logs");
+    }
+
+    sim.ready_queue.reserve(list_processes.size());
+    sim.wait_queue.reserve(list_processes.size());
+    sim.execution_status.reserve(execution_size);
+    sim.devices.reserve(config.io_devices.size());
+    sim.memory_log.reserve(memory_size);
+    sim.suspended_ready.reserve(list_processes.size());
+    sim.releases.reserve(list_processes.size());
+    sim.rt_stats.reserve(list_processes.size());
+    sim.swap_queue.reserve(list_processes.size());
+
+    for(const auto &device_config : config.io_devices) {
+        sim.devices.emplace_back();
+        io_device &device = sim.devices.back();
+        device.config = device_config;
+        device.queue.reserve(list_processes.size());
+        device.freed_at.reserve(list_processes.size());
+    }
+
+    for(const auto &process : list_processes) {
+        sim.arrival_order.push_back(load_process(sim.table, process));
+    }
+
+    //page tables are sized here so admitting a process does not allocate
+    init_paging(sim.paging, config);
+    if (sim.paging.enabled && sim.paging.page_tables.size() < list_processes.size()) {
+        sim.paging.page_tables.resize(list_processes.size());
+    }
+    for (std::size_t slot = 0; sim.paging.enabled && slot < list_processes.size(); slot++) {
+        sim.paging.page_tables[slot].reserve(page_count(sim.paging.config, list_processes[slot].size));
+    }
+    //stable so that processes arriving together are admitted in input order
+    std::stable_sort(sim.arrival_order.begin(), sim.arrival_order.end(), [&](uint32_t a, uint32_t b) {
+        return sim.table.arrival_time[a] < sim.table.arrival_time[b];
+    });
+
+    sim.next_arrival = 0;
+    sim.whole_workload = config.whole_workload;
+    sim.arrival_stream = config.stream ? config.arrival_stream : nullptr;
+    sim.have_next_process = false;
+    sim.execution_sink = config.execution_sink;
+    sim.memory_sink = config.memory_sink;
+    sim.running = NO_PROCESS;
+    sim.current_time = 0;
+    sim.admitted = 0;
+    sim.terminated = 0;
+    sim.cpu_busy = 0;
+    sim.swapping = config.swapping;
+    sim.swap_out_latency = config.swap_out_latency;
+    sim.swap_in_latency = config.swap_in_latency;
+    sim.swap_outs = 0;
+    sim.swap_ins = 0;
+    sim.slice_left = 0;
+    sim.starvation_threshold = config.starvation_threshold;
+    sim.wait_report = config.wait_report;
+    sim.total_wait = 0;
+    sim.max_wait = 0;
+    sim.max_wait_PID = -1;
+    sim.starved = 0;
+    sim.rt_policy = rt_policy;
+    sim.horizon = config.horizon;
+    sim.rt_utilization = 0;
+    sim.rt_tasks = 0;
+    sim.rt_rejected = 0;
+    sim.switch_cost = config.switch_cost;
+    sim.cache_penalty = config.cache_penalty;
+    sim.cache_decay = config.cache_decay;
+    sim.last_ran = NO_PROCESS;
+    sim.context_switches = 0;
+    sim.switch_overhead = 0;
+    sim.cache_overhead = 0;
+    sim.interrupts = config.interrupts;
+    sim.isr_time = config.isr_time;
+    sim.irq_batch = config.irq_batch;
+    sim.irq_timeout = config.irq_timeout;
+    sim.irq_pending.reserve(list_processes.size());
+    sim.irq_service.reserve(list_processes.size());
+    sim.irq_oldest = UINT32_MAX;
+    sim.isr_left = 0;
+    sim.interrupts_raised = 0;
+    sim.irq_completions = 0;
+    sim.isr_busy = 0;
+    sim.irq_latency = 0;
+    sim.max_irq_latency = 0;
+
+    //make the output table (the header row)
+    sim.execution_status += print_exec_header();
+    sim.loop_allocations = 0;
+    sim.exit_on_allocations = config.exit_on_allocations;
+}
+
+//Call right before the main loop starts
+void begin_steady_state(simulation &sim) {
+#ifdef SIM_PROFILE
+    //a few spans per transition is plenty for a readable trace
+    profile_begin(std::max<std::size_t>(4096, sim.execution_status.capacity() / 8));
+#endif
+#ifdef COUNT_ALLOCATIONS
+    sim.loop_allocations = allocation_count;
+#else
+    (void)sim;
+#endif
+}
+
+//Call right after the main loop ends. With COUNT_ALLOCATIONS, any allocation made by
+//the loop is reported and the program fails, unless the caller reports it itself
+//(see sim_metrics::loop_allocations).
+void end_steady_state(simulation &sim) {
+#ifdef SIM_PROFILE
+    profile_end();
+#endif
+#ifdef COUNT_ALLOCATIONS
+    sim.loop_allocations = allocation_count - sim.loop_allocations;
+    //a streaming run grows its table with the number of live processes, so only
+    //runs that load the whole workload up front are held to zero
+    if (sim.arrival_stream != nullptr) {
+        sim.loop_allocations = 0;
+    }
+    if (sim.loop_allocations != 0 && sim.exit_on_allocations) {
+        std::cerr << "Error: simulation loop performed " << sim.loop_allocations
+                  << " heap allocations" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+#else
+    (void)sim;
+#endif
+#ifdef SIM_PROFILE
+    profile_report_run();
+#endif
+}
+
+//Streaming mode: make sure the next arrival has been read ahead. Returns false once
+//the input is exhausted. Blank lines are skipped, and so are processes naming an
+//I/O device that is not configured (with an error).
+bool peek_arrival(simulation &sim) {
+    while (!sim.have_next_process && std::getline(*sim.arrival_stream, sim.arrival_line)) {
+        if (sim.arrival_line.empty() || sim.arrival_line == "\r") {
+            continue;
+        }
+        sim.next_process = add_process(split_delim(sim.arrival_line, ", "));
+        if (sim.next_process.io_device > sim.devices.size()) {
+            std::cerr << "Error: Process " << sim.next_process.PID << " uses I/O device "
+                      << sim.next_process.io_device << " but only " << sim.devices.size()
+                      << " are configured" << std::endl;
+            continue;
+        }
+        sim.have_next_process = true;
+    }
+    return sim.have_next_process;
+}
+
+//Streaming mode: give a slot back once its process has left the system
+void release_slot(simulation &sim, uint32_t slot) {
+    if (sim.arrival_stream != nullptr) {
+        sim.free_slots.push_back(slot);
+    }
+}
+
+//Real-time order of the ready set: smallest rt_key first, then lowest PID
+bool ready_before(const process_table &table, uint32_t a, uint32_t b) {
+    return table.rt_key[a] < table.rt_key[b] || (table.rt_key[a] == table.rt_key[b] && table.PID[a] < table.PID[b]);
+}
+
+//Put a process at the back of the ready queue, noting when it started waiting.
+//Under EDF and RM the ready queue is a heap with the most urgent job on top.
+void make_ready(simulation &sim, uint32_t slot) {
+    sim.table.ready_since[slot] = sim.current_time;
+    sim.ready_queue.push_back(slot);
+    if (sim.rt_policy != RT_NONE) {
+        std::push_heap(sim.ready_queue.begin(), sim.ready_queue.end(), [&](uint32_t a, uint32_t b) {
+            return ready_before(sim.table, b, a);
+        });
+    }
+}
+
+//------------------------------------REAL-TIME TASKS------------------------------
+//Under EDF and RM a process with a period is a periodic task: it releases a job at its
+//arrival time and every period after that until the horizon, each job needing
+//processing_time of CPU by its release plus the relative deadline (the period if no
+//deadline is given). A process without a period is a single job. The next release of
+//every task is kept in a min-heap of events, so releases cost O(log n) and nothing is
+//rescanned while time passes. A task whose job is still unfinished at a release gets
+//its next job as soon as the current one completes.
+
+//Density of a task, C / min(D, T): the share of the CPU it needs to meet its
+//deadlines, which is more than C / T when the deadline is shorter than the period.
+//0 if it has no deadline.
+double task_utilization(const process_table &table, uint32_t slot) {
+    unsigned int window = table.deadline[slot];
+    if (table.period[slot] > 0) {
+        window = std::min(window, table.period[slot]);
+    }
+    return window > 0 ? (double)table.processing_time[slot] / window : 0;
+}
+
+//Schedulability test at admission: the total density must stay within 1 under EDF,
+//and within the Liu and Layland bound n(2^(1/n) - 1) under RM. A job that needs more
+//CPU than its deadline allows can never make it and is always rejected.
+bool schedulable(const simulation &sim, uint32_t slot) {
+    double utilization = task_utilization(sim.table, slot);
+    if (utilization == 0) {
+        return true;
+    }
+    if (sim.table.processing_time[slot] > sim.table.deadline[slot]) {
+        return false;
+    }
+    double total = sim.rt_utilization + utilization;
+    double bound = 1.0;
+    if (sim.rt_policy == RT_RM) {
+        unsigned int n = sim.rt_tasks + 1;
+        bound = n * (std::pow(2.0, 1.0 / n) - 1);
+    }
+    return total <= bound + 1e-9;
+}
+
+//Absolute deadline of the task's current job, ULLONG_MAX if it has none
+unsigned long long job_deadline(const process_table &table, uint32_t slot) {
+    if (table.deadline[slot] == 0) {
+        return ULLONG_MAX;
+    }
+    return table.arrival_time[slot] + (unsigned long long)table.job_index[slot] * table.period[slot]
+           + table.deadline[slot];
+}
+
+//Ready set key of the task's current job
+void set_rt_key(simulation &sim, uint32_t slot) {
+    process_table &table = sim.table;
+    if (sim.rt_policy == RT_EDF) {
+        table.rt_key[slot] = job_deadline(table, slot);
+    } else if (table.period[slot] > 0) {
+        table.rt_key[slot] = table.period[slot];
+    } else {
+        table.rt_key[slot] = table.deadline[slot] > 0 ? table.deadline[slot] : ULLONG_MAX;
+    }
+}
+
+//Time of the task's next job release, UINT32_MAX if there are no more
+unsigned int next_release(const simulation &sim, uint32_t slot) {
+    const process_table &table = sim.table;
+    if (table.period[slot] == 0) {
+        return UINT32_MAX;
+    }
+    unsigned long long release = table.arrival_time[slot]
+                                 + (unsigned long long)table.jobs_released[slot] * table.period[slot];
+    return release < sim.horizon ? (unsigned int)release : UINT32_MAX;
+}
+
+void schedule_release(simulation &sim, uint32_t slot) {
+    unsigned int release = next_release(sim, slot);
+    if (release != UINT32_MAX) {
+        sim.releases.push_back({release, slot});
+        std::push_heap(sim.releases.begin(), sim.releases.end(), std::greater<std::pair<unsigned int, uint32_t>>());
+    }
+}
+
+//Set up an admitted task: its first job is released on arrival
+void start_task(simulation &sim, uint32_t slot) {
+    if (sim.rt_policy == RT_NONE) {
+        return;
+    }
+    process_table &table = sim.table;
+    double utilization = task_utilization(table, slot);
+    if (utilization > 0) {
+        sim.rt_utilization += utilization;
+        sim.rt_tasks++;
+    }
+    table.job_index[slot] = 0;
+    table.jobs_released[slot] = 1;
+    table.awaiting_release[slot] = 0;
+    set_rt_key(sim, slot);
+    schedule_release(sim, slot);
+}
+
+//Start the task's next job
+void start_next_job(simulation &sim, uint32_t slot) {
+    process_table &table = sim.table;
+    table.job_index[slot]++;
+    table.remaining_time[slot] = table.processing_time[slot];
+    set_rt_key(sim, slot);
+}
+
+//Release every job that is due. A task that was idle becomes ready; one still busy
+//with an earlier job picks the new one up when it finishes.
+void release_jobs(simulation &sim) {
+    process_table &table = sim.table;
+    while (!sim.releases.empty() && sim.releases.front().first <= sim.current_time) {
+        std::pop_heap(sim.releases.begin(), sim.releases.end(), std::greater<std::pair<unsigned int, uint32_t>>());
+        uint32_t slot = sim.releases.back().second;
+        sim.releases.pop_back();
+
+        table.jobs_released[slot]++;
+        if (table.awaiting_release[slot]) {
+            table.awaiting_release[slot] = 0;
+            start_next_job(sim, slot);
+            table.state[slot] = READY;
+            print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], WAITING, READY);
+            make_ready(sim, slot);
+        }
+        schedule_release(sim, slot);
+    }
+}
+
+//Returns true once every admitted process has terminated. A streaming run, or a
+//cluster node's run, also needs its arrivals to be exhausted. A run where nothing has
+//been admitted yet only ends once no arrivals are left (e.g. none of them fit in memory).
+bool all_process_terminated(simulation &sim) {
+    if (sim.arrival_stream != nullptr) {
+        return sim.terminated == sim.admitted && !peek_arrival(sim);
+    }
+    bool arrivals_done = sim.next_arrival == sim.arrival_order.size();
+    return sim.terminated == sim.admitted
+           && (arrivals_done || (sim.admitted != 0 && !sim.whole_workload));
+}
+
+//------------------------------------PAGED VIRTUAL MEMORY------------------------------
+//With --paging every process gets a page table instead of a partition. While it runs
+//a process makes a memory access every access_interval of CPU time. Its accesses
+//cycle through a working set of pages that moves on with every CPU burst, so each
+//burst brings in a new set of pages. A TLB miss walks the page table; a page that is
+//not resident is read into a frame (replacing one if none is free) and the process
+//blocks in the wait queue for fault_latency, the same way it would for an I/O.
+
+//Take a frame off the FIFO/LRU list
+void unlink_frame(paging_state &paging, int32_t f) {
+    page_frame &frame = paging.frames[f];
+    if (frame.prev != -1) {
+        paging.frames[frame.prev].next = frame.next;
+    } else {
+        paging.head = frame.next;
+    }
+    if (frame.next != -1) {
+        paging.frames[frame.next].prev = frame.prev;
+    } else {
+        paging.tail = frame.prev;
+    }
+    frame.prev = -1;
+    frame.next = -1;
+}
+
+//Put a frame at the head of the FIFO/LRU list
+void push_frame(paging_state &paging, int32_t f) {
+    page_frame &frame = paging.frames[f];
+    frame.prev = -1;
+    frame.next = paging.head;
+    if (paging.head != -1) {
+        paging.frames[paging.head].prev = f;
+    } else {
+        paging.tail = f;
+    }
+    paging.head = f;
+}
+
+//Record a use of a resident page for the replacement policy
+void touch_frame(paging_state &paging, int32_t f) {
+    if (paging.config.policy == REPLACE_LRU) {
+        unlink_frame(paging, f);
+        push_frame(paging, f);
+    } else if (paging.config.policy == REPLACE_CLOCK) {
+        paging.frames[f].referenced = true;
+    }
+}
+
+//Returns true if (slot, page) is in the TLB
+bool tlb_lookup(paging_state &paging, uint32_t slot, uint32_t page) {
+    for (auto &entry : paging.tlb) {
+        if (entry.slot == slot && entry.page == page) {
+            entry.last_use = ++paging.tlb_clock;
+            return true;
+        }
+    }
+    return false;
+}
+
+//Add (slot, page) to the TLB, in an unused entry or else the least recently used one
+void tlb_insert(paging_state &paging, uint32_t slot, uint32_t page) {
+    if (paging.tlb.empty()) {
+        return;
+    }
+    tlb_entry* victim = &paging.tlb[0];
+    for (auto &entry : paging.tlb) {
+        if (entry.slot == NO_PROCESS) {
+            victim = &entry;
+            break;
+        }
+        if (entry.last_use < victim->last_use) {
+            victim = &entry;
+        }
+    }
+    *victim = {slot, page, ++paging.tlb_clock};
+}
+
+//Drop the TLB entry of one page, or of every page of slot if page is UINT32_MAX
+void tlb_invalidate(paging_state &paging, uint32_t slot, uint32_t page) {
+    for (auto &entry : paging.tlb) {
+        if (entry.slot == slot && (page == UINT32_MAX || entry.page == page)) {
+            entry.slot = NO_PROCESS;
+        }
+    }
+}
+
+//Pick the frame to replace: the tail of the list for FIFO and LRU, or the first
+//frame the clock hand finds with its reference bit clear
+int32_t choose_victim_frame(paging_state &paging) {
+    if (paging.config.policy != REPLACE_CLOCK) {
+        return paging.tail;
+    }
+    while (paging.frames[paging.hand].referenced) {
+        paging.frames[paging.hand].referenced = false;
+        paging.hand = (paging.hand + 1) % paging.frames.size();
+    }
+    int32_t victim = paging.hand;
+    paging.hand = (paging.hand + 1) % paging.frames.size();
+    return victim;
+}
+
+//Read a page into a frame, replacing a resident page if no frame is free
+void load_page(paging_state &paging, uint32_t slot, uint32_t page) {
+    int32_t f;
+    if (!paging.free_frames.empty()) {
+        f = paging.free_frames.back();
+        paging.free_frames.pop_back();
+    } else {
+        f = choose_victim_frame(paging);
+        page_frame &victim = paging.frames[f];
+        paging.page_tables[victim.slot][victim.page] = -1;
+        tlb_invalidate(paging, victim.slot, victim.page);
+        if (paging.config.policy != REPLACE_CLOCK) {
+            unlink_frame(paging, f);
+        }
+        paging.evictions++;
+    }
+
+    page_frame &frame = paging.frames[f];
+    frame.slot = slot;
+    frame.page = page;
+    frame.referenced = true;
+    if (paging.config.policy != REPLACE_CLOCK) {
+        push_frame(paging, f);
+    }
+    paging.page_tables[slot][page] = f;
+}
+
+//Give an admitted process an empty page table. Its working set is about half the
+//accesses of one CPU burst, so every page in it is used more than once per burst.
+void create_page_table(simulation &sim, uint32_t slot) {
+    paging_state &paging = sim.paging;
+    process_table &table = sim.table;
+
+    if (paging.page_tables.size() <= slot) {
+        paging.page_tables.resize(slot + 1); //streaming mode only
+    }
+    unsigned int pages = page_count(paging.config, table.size[slot]);
+    paging.page_tables[slot].assign(pages, -1);
+
+    unsigned int burst_length = table.io_freq[slot] > 0 ? table.io_freq[slot] : table.processing_time[slot];
+    unsigned int burst_accesses = std::max(1u, burst_length / paging.config.access_interval);
+    table.working_set[slot] = std::min(pages, std::max(1u, burst_accesses / 2));
+    table.next_access[slot] = 0;
+    table.burst[slot] = 0;
+    table.burst_accesses[slot] = 0;
+    table.page_fault[slot] = 0;
+}
+
+//Free every frame held by a terminating process
+void release_pages(paging_state &paging, uint32_t slot) {
+    for (int32_t f : paging.page_tables[slot]) {
+        if (f == -1) {
+            continue;
+        }
+        if (paging.config.policy != REPLACE_CLOCK) {
+            unlink_frame(paging, f);
+        }
+        paging.frames[f].slot = NO_PROCESS;
+        paging.frames[f].referenced = false;
+        paging.free_frames.push_back(f);
+    }
+    paging.page_tables[slot].clear();
+    tlb_invalidate(paging, slot, UINT32_MAX);
+}
+
+//Make the running process's memory access if one is due. On a page fault the
+//process moves to the wait queue until the page has been read in.
+void page_access(simulation &sim) {
+    paging_state &paging = sim.paging;
+    process_table &table = sim.table;
+    uint32_t slot = sim.running;
+    if (!paging.enabled || slot == NO_PROCESS || table.next_access[slot] > 0 || table.switch_left[slot] > 0) {
+        return;
+    }
+
+    std::vector<int32_t> &page_table = paging.page_tables[slot];
+    unsigned long working_set = table.working_set[slot];
+    uint32_t page = (table.burst[slot] * working_set + table.burst_accesses[slot] % working_set) % page_table.size();
+    table.burst_accesses[slot]++;
+    table.next_access[slot] = paging.config.access_interval;
+    paging.accesses++;
+
+    if (tlb_lookup(paging, slot, page)) {
+        paging.tlb_hits++;
+        touch_frame(paging, page_table[page]);
+        return;
+    }
+    if (page_table[page] != -1) {
+        touch_frame(paging, page_table[page]);
+        tlb_insert(paging, slot, page);
+        return;
+    }
+
+    paging.faults++;
+    load_page(paging, slot, page);
+    tlb_insert(paging, slot, page);
+
+    table.state[slot] = WAITING;
+    print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], RUNNING, WAITING);
+    table.page_fault[slot] = 1;
+    table.io_done[slot] = sim.current_time + paging.config.fault_latency;
+    sim.wait_queue.push_back(slot);
+    sim.running = NO_PROCESS;
+}
+
+//Give an arriving process its memory: a partition, or a page table when paging
+bool allocate_memory(simulation &sim, uint32_t slot) {
+    if (sim.paging.enabled) {
+        create_page_table(sim, slot);
+        return true;
+    }
+    return assign_partition(sim, slot);
+}
+
+//Give back the memory of a terminating process
+void release_memory(simulation &sim, uint32_t slot) {
+    if (sim.paging.enabled) {
+        release_pages(sim.paging, slot);
+    } else {
+        free_partition(sim, slot);
+    }
+}
+
+//Write the memory status after an admission or termination
+void log_memory(simulation &sim) {
+    if (sim.paging.enabled) {
+        logFrameStatus(sim.memory_log, sim.paging, sim.table.PID);
+    } else {
+        logMemoryStatus(sim.memory_log, sim.partitions);
+    }
+}
+
+//Admit a process that has just arrived if it fits in memory
+//Pick a process to swap out so that slot can have its partition: the waiting
+//process whose I/O finishes last, or failing that the lowest priority (highest PID)
+//ready process if it ranks below the newcomer. Its partition must be big enough.
+//Returns NO_PROCESS if there is no suitable victim.
+uint32_t choose_swap_victim(simulation &sim, uint32_t slot) {
+    process_table &table = sim.table;
+    uint32_t victim = NO_PROCESS;
+
+    auto fits = [&](uint32_t candidate) {
+        int partition = table.partition_number[candidate];
+        return partition > 0 && sim.partitions[partition - 1].size >= table.size[slot];
+    };
+
+    for (uint32_t candidate : sim.wait_queue) {
+        if (table.state[candidate] == WAITING && fits(candidate)
+            && (victim == NO_PROCESS || table.io_done[candidate] > table.io_done[victim])) {
+            victim = candidate;
+        }
+    }
+    if (victim != NO_PROCESS) {
+        return victim;
+    }
+
+    for (uint32_t candidate : sim.ready_queue) {
+        if (table.PID[candidate] > table.PID[slot] && fits(candidate)
+            && (victim == NO_PROCESS || table.PID[candidate] > table.PID[victim])) {
+            victim = candidate;
+        }
+    }
+    return victim;
+}
+
+//Swap a victim out to the backing store so that slot, which did not fit in memory,
+//can take its partition. slot becomes READY once the swap-out has finished.
+bool swap_out(simulation &sim, uint32_t slot) {
+    process_table &table = sim.table;
+    uint32_t victim = choose_swap_victim(sim, slot);
+    if (victim == NO_PROCESS) {
+        return false;
+    }
+
+    int partition = table.partition_number[victim];
+    if (table.state[victim] == WAITING) {
+        table.state[victim] = SUSP_WAIT;    //stays in the wait queue for its I/O
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[victim], WAITING, SUSP_WAIT);
+    } else {
+        sim.ready_queue.erase(std::find(sim.ready_queue.begin(), sim.ready_queue.end(), victim));
+        if (sim.rt_policy != RT_NONE) {
+            std::make_heap(sim.ready_queue.begin(), sim.ready_queue.end(), [&](uint32_t a, uint32_t b) {
+                return ready_before(table, b, a);
+            });
+        }
+        table.state[victim] = SUSP_READY;
+        sim.suspended_ready.push_back(victim);
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[victim], READY, SUSP_READY);
+    }
+    free_partition(sim, victim);
+    sim.swap_outs++;
+    logSwap(sim.memory_log, false, table.PID[victim], partition, sim.current_time);
+
+    assign_partition(sim, slot);
+    table.swap_done[slot] = sim.current_time + sim.swap_out_latency;
+    sim.swap_queue.push_back(slot);
+    logMemoryStatus(sim.memory_log, sim.partitions);
+    return true;
+}
+
+void admit_process(simulation &sim, uint32_t slot) {
+    process_table &table = sim.table;
+
+    if (sim.rt_policy != RT_NONE && !schedulable(sim, slot)) {
+        sim.rt_rejected++;
+        release_slot(sim, slot);
+        return;
+    }
+
+    if(allocate_memory(sim, slot)) {
+        start_task(sim, slot);
+        table.state[slot] = READY;
+        make_ready(sim, slot);
+        sim.admitted++;
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], NEW, READY);
+        log_memory(sim);
+    } else if (sim.swapping && swap_out(sim, slot)) {
+        start_task(sim, slot);
+        table.state[slot] = NEW;
+        sim.admitted++;
+    } else {
+        release_slot(sim, slot);
+    }
+}
+
+//Populate the ready queue with processes as they arrive. A process whose arrival
+//time was stepped over, or that does not fit in memory, is never admitted.
+void admit_arrivals(simulation &sim) {
+    process_table &table = sim.table;
+
+    if (sim.arrival_stream != nullptr) {
+        //arrivals must be in order of arrival time, as in the input files
+        while (peek_arrival(sim) && sim.next_process.arrival_time <= sim.current_time) {
+            sim.have_next_process = false;
+            if (sim.next_process.arrival_time != sim.current_time) {
+                continue;
+            }
+            uint32_t slot;
+            if (sim.free_slots.empty()) {
+                slot = load_process(table, sim.next_process);
+            } else {
+                slot = sim.free_slots.back();
+                sim.free_slots.pop_back();
+                store_process(table, slot, sim.next_process);
+            }
+            admit_process(sim, slot);
+        }
+        return;
+    }
+
+    while(sim.next_arrival < sim.arrival_order.size()
+          && table.arrival_time[sim.arrival_order[sim.next_arrival]] <= sim.current_time) {
+        uint32_t slot = sim.arrival_order[sim.next_arrival++];
+
+        if(table.arrival_time[slot] == sim.current_time) {
+            admit_process(sim, slot);
+        }
+    }
+}
+
+//Time of the next arrival, I/O completion, swap, job release or coalescing timeout,
+//UINT32_MAX if none
+unsigned int next_event_time(simulation &sim) {
+    unsigned int next_event = UINT32_MAX;
+
+    if (sim.arrival_stream != nullptr) {
+        if (peek_arrival(sim)) {
+            next_event = sim.next_process.arrival_time;
+        }
+    } else if (sim.next_arrival < sim.arrival_order.size()) {
+        next_event = sim.table.arrival_time[sim.arrival_order[sim.next_arrival]];
+    }
+    for (uint32_t slot : sim.wait_queue) {
+        next_event = std::min(next_event, sim.table.io_done[slot]);
+    }
+    for (uint32_t slot : sim.swap_queue) {
+        next_event = std::min(next_event, sim.table.swap_done[slot]);
+    }
+    if (!sim.releases.empty()) {
+        next_event = std::min(next_event, sim.releases.front().first);
+    }
+    if (!sim.irq_pending.empty() && sim.irq_service.empty()) {
+        next_event = std::min(next_event, sim.irq_oldest + sim.irq_timeout);
+    }
+    return next_event;
+}
+
+//Advance the clock while the CPU is idle. Nothing can happen before the next arrival
+//or I/O completion, so jump straight there instead of ticking through every
+//millisecond (it ticks once if nothing is pending).
+void idle_CPU(simulation &sim) {
+    unsigned int next_event = next_event_time(sim);
+
+    if (next_event != UINT32_MAX && next_event > sim.current_time) {
+        sim.current_time = next_event;
+    } else {
+        sim.current_time++;
+    }
+}
+
+//Streaming mode: hand finished rows to the output files so the logs do not grow
+//with the length of the run
+void flush_outputs(simulation &sim) {
+    const std::size_t flush_size = 1 << 16;
+
+    if (sim.execution_sink != nullptr && sim.execution_status.size() >= flush_size) {
+        sim.execution_sink->write(sim.execution_status.data(), sim.execution_status.size());
+        sim.execution_status.clear();
+    }
+    if (sim.memory_sink != nullptr && sim.memory_log.size() >= flush_size) {
+        sim.memory_sink->write(sim.memory_log.data(), sim.memory_log.size());
+        sim.memory_log.clear();
+    }
+}
+
+//Start serving an I/O request on its device at time start
+void begin_io_service(simulation &sim, io_device &device, uint32_t slot, unsigned int start) {
+    process_table &table = sim.table;
+    unsigned int delay = start - table.io_request[slot];
+
+    table.io_done[slot] = start + table.io_duration[slot];
+    device.in_service++;
+    device.busy_time += table.io_duration[slot];
+    device.total_delay += delay;
+    device.max_delay = std::max(device.max_delay, delay);
+}
+
+//Hand a device that has become free to the next queued request, if any. Returns
+//true if that request has already completed by the current time.
+bool next_io_request(simulation &sim, io_device &device, unsigned int free_time) {
+    process_table &table = sim.table;
+
+    device.in_service--;
+    if (device.queue.empty()) {
+        return false;
+    }
+
+    auto next = device.queue.begin();
+    if (device.config.discipline == IO_PRIORITY) {
+        next = std::min_element(device.queue.begin(), device.queue.end(), [&](uint32_t a, uint32_t b) {
+            return table.PID[a] < table.PID[b];
+        });
+    }
+    uint32_t slot = *next;
+    device.queue.erase(next);
+
+    begin_io_service(sim, device, slot, std::max(free_time, table.io_request[slot]));
+    return table.io_done[slot] <= sim.current_time;
+}
+
+//End of an interrupt service routine: the completions it serviced become READY
+void deliver_interrupt(simulation &sim) {
+    process_table &table = sim.table;
+    for (uint32_t slot : sim.irq_service) {
+        unsigned int latency = sim.current_time - table.io_done[slot];
+        sim.irq_latency += latency;
+        sim.max_irq_latency = std::max(sim.max_irq_latency, latency);
+        table.state[slot] = READY;
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], WAITING, READY);
+        make_ready(sim, slot);
+    }
+    sim.irq_completions += sim.irq_service.size();
+    sim.irq_service.clear();
+}
+
+//Raise an interrupt for the pending completions once there are irq_batch of them or
+//the oldest has waited irq_timeout. Only one service routine runs at a time; what
+//completes meanwhile waits for the next interrupt.
+void raise_interrupt(simulation &sim) {
+    if (sim.irq_pending.empty() || !sim.irq_service.empty()) {
+        return;
+    }
+    if (sim.irq_pending.size() < sim.irq_batch && sim.current_time < sim.irq_oldest + sim.irq_timeout) {
+        return;
+    }
+
+    sim.irq_service.swap(sim.irq_pending);
+    sim.irq_oldest = UINT32_MAX;
+    sim.interrupts_raised++;
+    sim.isr_left = sim.isr_time;
+    if (sim.isr_left == 0) {
+        deliver_interrupt(sim);
+    }
+}
+
+//Spend up to max_time in the interrupt service routine, ahead of the running process.
+//Returns false if no interrupt is being serviced.
+bool service_interrupt(simulation &sim, unsigned int max_time) {
+    if (sim.irq_service.empty()) {
+        return false;
+    }
+
+    unsigned int step = std::min(sim.isr_left, max_time);
+    sim.isr_left -= step;
+    sim.current_time += step;
+    sim.isr_busy += step;
+    if (sim.isr_left == 0) {
+        deliver_interrupt(sim);
+    }
+    return true;
+}
+
+//Move every process whose I/O has completed from the wait queue to the ready queue,
+//or with --interrupts, to the pending completions of the next interrupt
+void manage_wait_queue(simulation &sim) {
+    process_table &table = sim.table;
+
+    bool rescan = true;
+    while (rescan) {
+        std::size_t kept = 0;
+        for(std::size_t i = 0; i < sim.wait_queue.size(); i++) {
+            uint32_t slot = sim.wait_queue[i];
+            if(table.io_done[slot] <= sim.current_time) {
+                if (table.state[slot] == SUSP_WAIT) {
+                    //done with I/O but still swapped out
+                    table.state[slot] = SUSP_READY;
+                    print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], SUSP_WAIT, SUSP_READY);
+                    sim.suspended_ready.push_back(slot);
+                } else if (sim.interrupts) {
+                    //stays WAITING until an interrupt delivers the completion
+                    sim.irq_pending.push_back(slot);
+                    sim.irq_oldest = std::min(sim.irq_oldest, table.io_done[slot]);
+                } else {
+                    table.state[slot] = READY;
+                    print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], WAITING, READY);
+                    make_ready(sim, slot);
+                }
+                if (table.page_fault[slot]) {
+                    table.page_fault[slot] = 0;     //page read in, no device to hand over
+                } else if (table.io_device[slot] != 0) {
+                    sim.devices[table.io_device[slot] - 1].freed_at.push_back(table.io_done[slot]);
+                }
+            } else {
+                sim.wait_queue[kept++] = slot;
+            }
+        }
+        sim.wait_queue.resize(kept);
+
+        //Devices freed during the scan take their next request in order of the
+        //time they became free. If one of those is already done, scan again.
+        rescan = false;
+        for (auto &device : sim.devices) {
+            std::sort(device.freed_at.begin(), device.freed_at.end());
+            for (unsigned int free_time : device.freed_at) {
+                rescan |= next_io_request(sim, device, free_time);
+            }
+            device.freed_at.clear();
+        }
+    }
+    raise_interrupt(sim);
+}
+
+//Medium-term scheduler: finish swaps that are done, then swap suspended ready
+//processes back in, oldest first, while partitions are free for them
+void manage_swapping(simulation &sim) {
+    if (!sim.swapping) {
+        return;
+    }
+    process_table &table = sim.table;
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < sim.swap_queue.size(); i++) {
+        uint32_t slot = sim.swap_queue[i];
+        if (table.swap_done[slot] <= sim.current_time) {
+            states old_state = table.state[slot];
+            table.state[slot] = READY;
+            print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], old_state, READY);
+            make_ready(sim, slot);
+        } else {
+            sim.swap_queue[kept++] = slot;
+        }
+    }
+    sim.swap_queue.resize(kept);
+
+    kept = 0;
+    for (std::size_t i = 0; i < sim.suspended_ready.size(); i++) {
+        uint32_t slot = sim.suspended_ready[i];
+        if (assign_partition(sim, slot)) {
+            sim.swap_ins++;
+            logSwap(sim.memory_log, true, table.PID[slot], table.partition_number[slot], sim.current_time);
+            logMemoryStatus(sim.memory_log, sim.partitions);
+            table.swap_done[slot] = sim.current_time + sim.swap_in_latency;
+            if (sim.swap_in_latency == 0) {
+                table.state[slot] = READY;
+                print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], SUSP_READY, READY);
+                make_ready(sim, slot);
+            } else {
+                sim.swap_queue.push_back(slot);
+            }
+        } else {
+            sim.suspended_ready[kept++] = slot;
+        }
+    }
+    sim.suspended_ready.resize(kept);
+}
+
+//Extra switch time for a process whose cache contents have been pushed out. The cache
+//goes cold as other processes run: after cache_decay of their CPU time the full
+//penalty applies, and a process that never ran always pays it. It is added to
+//cache_overhead as context_switch works it off.
+unsigned int cache_penalty(const simulation &sim, uint32_t slot) {
+    if (sim.cache_penalty == 0) {
+        return 0;
+    }
+    unsigned long others = sim.table.last_busy[slot] == ULONG_MAX ? sim.cache_decay
+                                                                   : sim.cpu_busy - sim.table.last_busy[slot];
+    unsigned int penalty = (unsigned int)((unsigned long long)sim.cache_penalty
+                                          * std::min<unsigned long>(others, sim.cache_decay) / sim.cache_decay);
+    return penalty;
+}
+
+//Put the process at the front of the ready queue on the CPU
+void run_process(simulation &sim) {
+    process_table &table = sim.table;
+
+    if (sim.rt_policy != RT_NONE) {
+        std::pop_heap(sim.ready_queue.begin(), sim.ready_queue.end(), [&](uint32_t a, uint32_t b) {
+            return ready_before(table, b, a);
+        });
+        sim.running = sim.ready_queue.back();
+        sim.ready_queue.pop_back();
+    } else {
+        sim.running = sim.ready_queue.front();
+        sim.ready_queue.erase(sim.ready_queue.begin());
+    }
+
+    table.state[sim.running] = RUNNING;
+    if(table.start_time[sim.running] == -1) {
+        table.start_time[sim.running] = sim.current_time;
+    }
+
+    unsigned int wait = sim.current_time - table.ready_since[sim.running];
+    sim.total_wait += wait;
+    if (wait > table.longest_wait[sim.running]) {
+        if (table.longest_wait[sim.running] <= sim.starvation_threshold && wait > sim.starvation_threshold) {
+            sim.starved++;
+        }
+        table.longest_wait[sim.running] = wait;
+    }
+    if (wait > sim.max_wait) {
+        sim.max_wait = wait;
+        sim.max_wait_PID = table.PID[sim.running];
+    }
+
+    //switching to a process other than the last one to run costs CPU time
+    uint32_t slot = sim.running;
+    if (slot != sim.last_ran) {
+        if (sim.last_ran != NO_PROCESS) {
+            table.last_busy[sim.last_ran] = sim.cpu_busy;
+        }
+        sim.last_ran = slot;
+        sim.context_switches++;
+
+        unsigned int penalty = cache_penalty(sim, slot);
+        unsigned int overhead = sim.switch_cost + penalty;
+        if (overhead > 0) {
+            table.state[slot] = SWITCHING;
+            table.switch_left[slot] = overhead;
+            table.cache_left[slot] = penalty;
+            print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], READY, SWITCHING);
+            return;
+        }
+    }
+    print_exec_status(sim.execution_status, sim.current_time, table.PID[sim.running], READY, RUNNING);
+}
+
+//Spend up to max_time on the running process's context switch. Returns false if the
+//switch is already done, so the process can run.
+bool context_switch(simulation &sim, unsigned int max_time) {
+    process_table &table = sim.table;
+    uint32_t slot = sim.running;
+    if (table.switch_left[slot] == 0) {
+        return false;
+    }
+
+    unsigned int step = std::min(table.switch_left[slot], max_time);
+    unsigned int fixed_left = table.switch_left[slot] - table.cache_left[slot];
+    unsigned int cache_step = step > fixed_left ? step - fixed_left : 0;
+    table.switch_left[slot] -= step;
+    table.cache_left[slot] -= cache_step;
+    sim.current_time += step;
+    sim.switch_overhead += step;
+    sim.cache_overhead += cache_step;
+    if (table.switch_left[slot] == 0) {
+        table.state[slot] = RUNNING;
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], SWITCHING, RUNNING);
+    }
+    return true;
+}
+
+//Terminates the running process and frees its partition
+void terminate_process(simulation &sim) {
+    process_table &table = sim.table;
+    uint32_t slot = sim.running;
+
+    table.remaining_time[slot] = 0;
+    table.state[slot] = TERMINATED;
+    print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], RUNNING, TERMINATED);
+    release_memory(sim, slot);
+    log_memory(sim);
+
+    sim.terminated++;
+    sim.running = NO_PROCESS;
+    if (sim.last_ran == slot) {
+        sim.last_ran = NO_PROCESS;  //the slot may be reused
+    }
+    release_slot(sim, slot);
+}
+
+//Moves the running process to the wait queue for its I/O
+void start_io(simulation &sim) {
+    process_table &table = sim.table;
+    uint32_t slot = sim.running;
+
+    table.state[slot] = WAITING;
+    print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], RUNNING, WAITING);
+
+    table.next_io[slot] = table.io_freq[slot]; //restart the countdown for the next I/O
+    table.io_request[slot] = sim.current_time;
+    table.burst[slot]++;                        //the next burst works on other pages
+    table.burst_accesses[slot] = 0;
+
+    if (table.io_device[slot] == 0) {
+        table.io_done[slot] = sim.current_time + table.io_duration[slot];
+    } else {
+        io_device &device = sim.devices[table.io_device[slot] - 1];
+        device.requests++;
+        if (device.in_service < device.config.concurrency) {
+            begin_io_service(sim, device, slot, sim.current_time);
+        } else {
+            table.io_done[slot] = IO_NOT_STARTED;
+            device.queue.push_back(slot);
+        }
+    }
+
+    sim.wait_queue.push_back(slot);
+    sim.running = NO_PROCESS;
+}
+
+//Puts the running process back at the end of the ready queue
+void preempt_process(simulation &sim) {
+    process_table &table = sim.table;
+    uint32_t slot = sim.running;
+
+    states old_state = table.state[slot];   //SWITCHING if preempted before its switch was done
+    table.state[slot] = READY;
+    table.switch_left[slot] = 0;
+    table.cache_left[slot] = 0;
+    if (old_state == SWITCHING) {
+        //its context never finished loading: the next dispatch is a full switch, and
+        //its cache is no warmer than when it last really ran
+        sim.last_ran = NO_PROCESS;
+    }
+    print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], old_state, READY);
+
+    make_ready(sim, slot);
+    sim.running = NO_PROCESS;
+}
+
+//Record the task's deadline statistics once it has finished for good
+void end_task(simulation &sim, uint32_t slot) {
+    process_table &table = sim.table;
+    double utilization = task_utilization(table, slot);
+    if (utilization > 0) {
+        sim.rt_utilization -= utilization;
+        sim.rt_tasks--;
+        if (sim.rt_tasks == 0) {
+            sim.rt_utilization = 0; //do not let rounding build up
+        }
+    }
+    sim.rt_stats.push_back({table.PID[slot], table.period[slot], table.deadline[slot], table.job_index[slot] + 1,
+                            table.misses[slot], table.total_lateness[slot], table.max_lateness[slot]});
+}
+
+//The running job has used all its CPU time. Check it against its deadline, then run
+//the task's next job if it has been released, wait for the next release, or end the task.
+void finish_job(simulation &sim) {
+    process_table &table = sim.table;
+    uint32_t slot = sim.running;
+
+    unsigned long long deadline = job_deadline(table, slot);
+    if (sim.current_time > deadline) {
+        unsigned int lateness = sim.current_time - deadline;
+        table.misses[slot]++;
+        table.total_lateness[slot] += lateness;
+        table.max_lateness[slot] = std::max(table.max_lateness[slot], lateness);
+    }
+
+    bool pending = table.jobs_released[slot] > table.job_index[slot] + 1;
+    if (pending) {
+        start_next_job(sim, slot);
+        table.state[slot] = READY;
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], RUNNING, READY);
+        make_ready(sim, slot);
+        sim.running = NO_PROCESS;
+    } else if (next_release(sim, slot) != UINT32_MAX) {
+        table.awaiting_release[slot] = 1;
+        table.state[slot] = WAITING;
+        print_exec_status(sim.execution_status, sim.current_time, table.PID[slot], RUNNING, WAITING);
+        sim.running = NO_PROCESS;
+    } else {
+        end_task(sim, slot);
+        terminate_process(sim);
+    }
+}
+
+//Returns true if a ready job is more urgent than the running one. A job that is only
+//as urgent does not preempt.
+bool should_preempt(const simulation &sim) {
+    return sim.running != NO_PROCESS && !sim.ready_queue.empty()
+           && sim.table.rt_key[sim.ready_queue.front()] < sim.table.rt_key[sim.running];
+}
+
+//Per-task deadline misses and lateness, empty unless running EDF or RM
+std::string print_rt_status(const simulation &sim) {
+    if (sim.rt_policy == RT_NONE) {
+        return "";
+    }
+
+    const int tableWidth = 83;
+    std::stringstream buffer;
+
+    buffer << "Real-Time Status:" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(tableWidth) << "+" << std::endl;
+    buffer << "|"
+           << std::setfill(' ') << std::setw(4) << "PID"
+           << std::setw(2) << "|"
+           << std::setw(7) << "Period"
+           << std::setw(2) << "|"
+           << std::setw(9) << "Deadline"
+           << std::setw(2) << "|"
+           << std::setw(5) << "Jobs"
+           << std::setw(2) << "|"
+           << std::setw(7) << "Misses"
+           << std::setw(2) << "|"
+           << std::setw(14) << "Max Lateness"
+           << std::setw(2) << "|"
+           << std::setw(14) << "Avg Lateness"
+           << std::setw(2) << "|"
+           << std::setw(9) << "Miss %"
+           << std::setw(2) << "|" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(tableWidth) << "+" << std::endl;
+
+    unsigned long jobs = 0;
+    unsigned long misses = 0;
+    unsigned int max_lateness = 0;
+    for (const auto &task : sim.rt_stats) {
+        double average = task.misses > 0 ? (double)task.total_lateness / task.misses : 0;
+        double miss_rate = task.jobs > 0 ? 100.0 * task.misses / task.jobs : 0;
+        buffer << "|"
+               << std::setfill(' ') << std::setw(4) << task.PID
+               << std::setw(2) << "|"
+               << std::setw(7) << task.period
+               << std::setw(2) << "|"
+               << std::setw(9) << task.deadline
+               << std::setw(2) << "|"
+               << std::setw(5) << task.jobs
+               << std::setw(2) << "|"
+               << std::setw(7) << task.misses
+               << std::setw(2) << "|"
+               << std::setw(14) << task.max_lateness
+               << std::setw(2) << "|"
+               << std::fixed << std::setprecision(2) << std::setw(14) << average
+               << std::setw(2) << "|"
+               << std::setprecision(1) << std::setw(8) << miss_rate << "%"
+               << std::setw(2) << "|" << std::endl;
+        jobs += task.jobs;
+        misses += task.misses;
+        max_lateness = std::max(max_lateness, task.max_lateness);
+    }
+    buffer << "+" << std::setfill('-') << std::setw(tableWidth) << "+" << std::endl;
+
+    buffer << "Policy: " << (sim.rt_policy == RT_EDF ? "EDF" : "RM") << ", horizon: " << sim.horizon
+           << ", admission test: " << (sim.rt_policy == RT_EDF ? "sum C/min(D,T) <= 1" : "sum C/min(D,T) <= n(2^(1/n) - 1)")
+           << ", tasks rejected: " << sim.rt_rejected << std::endl;
+    buffer << "Jobs: " << jobs << ", deadline misses: " << misses
+           << " (" << std::fixed << std::setprecision(1) << (jobs > 0 ? 100.0 * misses / jobs : 0) << "%)"
+           << ", max lateness: " << max_lateness << std::endl;
+
+    return buffer.str();
+}
+
+//Table of per-device utilization and queueing delay, empty if no devices were configured
+std::string print_device_status(const simulation &sim) {
+    if (sim.devices.empty()) {
+        return "";
+    }
+
+    const int tableWidth = 81;
+    std::stringstream buffer;
+
+    buffer << "I/O Device Status:" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(tableWidth) << "+" << std::endl;
+    buffer << "|"
+           << std::setfill(' ') << std::setw(7) << "Device"
+           << std::setw(2) << "|"
+           << std::setw(11) << "Discipline"
+           << std::setw(2) << "|"
+           << std::setw(8) << "Servers"
+           << std::setw(2) << "|"
+           << std::setw(9) << "Requests"
+           << std::setw(2) << "|"
+           << std::setw(12) << "Utilization"
+           << std::setw(2) << "|"
+           << std::setw(10) << "Avg Delay"
+           << std::setw(2) << "|"
+           << std::setw(10) << "Max Delay"
+           << std::setw(2) << "|" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(tableWidth) << "+" << std::endl;
+
+    for (std::size_t d = 0; d < sim.devices.size(); d++) {
+        const io_device &device = sim.devices[d];
+        double capacity = (double)device.config.concurrency * sim.current_time;
+        double utilization = capacity > 0 ? 100.0 * device.busy_time / capacity : 0;
+        double avg_delay = device.requests > 0 ? (double)device.total_delay / device.requests : 0;
+
+        buffer << "|"
+               << std::setfill(' ') << std::setw(7) << d + 1
+               << std::setw(2) << "|"
+               << std::setw(11) << (device.config.discipline == IO_FIFO ? "FIFO" : "PRIORITY")
+               << std::setw(2) << "|"
+               << std::setw(8) << device.config.concurrency
+               << std::setw(2) << "|"
+               << std::setw(9) << device.requests
+               << std::setw(2) << "|"
+               << std::fixed << std::setprecision(1) << std::setw(11) << utilization << "%"
+               << std::setw(2) << "|"
+               << std::setprecision(2) << std::setw(10) << avg_delay
+               << std::setw(2) << "|"
+               << std::setw(10) << device.max_delay
+               << std::setw(2) << "|" << std::endl;
+    }
+    buffer << "+" << std::setfill('-') << std::setw(tableWidth) << "+" << std::endl;
+
+    return buffer.str();
+}
+
+//Implemented by each scheduler
+std::tuple<std::string, std::string> run_simulation(std::vector<PCB> list_processes, const sim_config &config);
+
+//Streaming mode: run the simulation reading arrivals from file_name ("-" for stdin),
+//writing the execution and memory logs out as the run goes
+int run_streaming(const char* file_name, sim_config &config) {
+    std::ifstream input_file;
+    config.arrival_stream = &std::cin;
+    if (std::string(file_name) != "-") {
+        input_file.open(file_name);
+        if (!input_file.is_open()) {
+            std::cerr << "Error: Unable to open file: " << file_name << std::endl;
+            return -1;
+        }
+        config.arrival_stream = &input_file;
+    }
+
+    std::ofstream execution_file("execution.txt");
+    std::ofstream memory_file("memorylog.txt");
+    if (!execution_file.is_open() || !memory_file.is_open()) {
+        std::cerr << "Error opening file!" << std::endl;
+        return -1;
+    }
+    config.execution_sink = &execution_file;
+    config.memory_sink = &memory_file;
+
+    auto [exec, memorystatus] = run_simulation({}, config);
+    execution_file << exec;
+    memory_file << memorystatus;
+
+    std::cout << "Output generated in execution.txt and memorylog.txt" << std::endl;
+    write_profile();
+
+    return 0;
+}
+
+//Fill in config.metrics, if the caller asked for them
+void collect_metrics(const simulation &sim, const sim_config &config) {
+    if (config.metrics == nullptr) {
+        return;
+    }
+    config.metrics->end_time = sim.current_time;
+    config.metrics->admitted = sim.admitted;
+    config.metrics->terminated = sim.terminated;
+    config.metrics->cpu_busy = sim.cpu_busy;
+    config.metrics->swap_outs = sim.swap_outs;
+    config.metrics->swap_ins = sim.swap_ins;
+    config.metrics->page_accesses = sim.paging.accesses;
+    config.metrics->tlb_hits = sim.paging.tlb_hits;
+    config.metrics->page_faults = sim.paging.faults;
+    config.metrics->evictions = sim.paging.evictions;
+    config.metrics->total_wait = sim.total_wait;
+    config.metrics->max_wait = sim.max_wait;
+    config.metrics->starved = sim.starved;
+    config.metrics->context_switches = sim.context_switches;
+    config.metrics->switch_overhead = sim.switch_overhead;
+    config.metrics->interrupts = sim.interrupts_raised;
+    config.metrics->isr_time = sim.isr_busy;
+    config.metrics->max_irq_latency = sim.max_irq_latency;
+    config.metrics->loop_allocations = sim.loop_allocations;
+    config.metrics->jobs = 0;
+    config.metrics->deadline_misses = 0;
+    for (const auto &task : sim.rt_stats) {
+        config.metrics->jobs += task.jobs;
+        config.metrics->deadline_misses += task.misses;
+    }
+}
+
+//Metrics as "end_time=<t> admitted=<n> ..." fields, for the server and batch mode
+std::string format_metrics(const sim_metrics &metrics) {
+    return "end_time=" + std::to_string(metrics.end_time)
+         + " admitted=" + std::to_string(metrics.admitted)
+         + " terminated=" + std::to_string(metrics.terminated)
+         + " cpu_busy=" + std::to_string(metrics.cpu_busy)
+         + " swap_outs=" + std::to_string(metrics.swap_outs)
+         + " swap_ins=" + std::to_string(metrics.swap_ins)
+         + " page_faults=" + std::to_string(metrics.page_faults)
+         + " max_wait=" + std::to_string(metrics.max_wait)
+         + " starved=" + std::to_string(metrics.starved)
+         + " deadline_misses=" + std::to_string(metrics.deadline_misses)
+         + " switch_overhead=" + std::to_string(metrics.switch_overhead)
+         + " interrupts=" + std::to_string(metrics.interrupts)
+         + " isr_time=" + std::to_string(metrics.isr_time)
+         + " max_irq_latency=" + std::to_string(metrics.max_irq_latency);
+}
+
+//Swap traffic summary, empty unless swapping is enabled
+std::string print_swap_status(const simulation &sim) {
+    if (!sim.swapping) {
+        return "";
+    }
+
+    std::stringstream buffer;
+    buffer << "Swap Status:" << std::endl;
+    buffer << "Swap-out latency: " << sim.swap_out_latency
+           << ", swap-in latency: " << sim.swap_in_latency << std::endl;
+    buffer << "Swap-outs: " << sim.swap_outs << ", swap-ins: " << sim.swap_ins
+           << ", time spent swapping: " << sim.swap_outs * sim.swap_out_latency + sim.swap_ins * sim.swap_in_latency
+           << std::endl;
+
+    return buffer.str();
+}
+
+//Context switch overhead, empty unless --context-switch was given
+std::string print_switch_status(const simulation &sim) {
+    if (sim.switch_cost == 0 && sim.cache_penalty == 0) {
+        return "";
+    }
+
+    auto percent = [&](unsigned long time) {
+        return sim.current_time > 0 ? 100.0 * time / sim.current_time : 0.0;
+    };
+
+    std::stringstream buffer;
+    buffer << std::fixed << std::setprecision(1);
+    buffer << "Context Switch Status:" << std::endl;
+    buffer << "Switch cost: " << sim.switch_cost << ", cache penalty: " << sim.cache_penalty
+           << ", cache decay: " << sim.cache_decay << std::endl;
+    buffer << "Context switches: " << sim.context_switches
+           << ", switch time: " << sim.switch_overhead - sim.cache_overhead
+           << ", cache penalty time: " << sim.cache_overhead << std::endl;
+    buffer << "CPU utilization: " << percent(sim.cpu_busy + sim.switch_overhead) << "%"
+           << " (useful work " << percent(sim.cpu_busy) << "%, switching " << percent(sim.switch_overhead) << "%)"
+           << std::endl;
+
+    return buffer.str();
+}
+
+//I/O interrupt traffic and cost, empty unless --interrupts was given
+std::string print_interrupt_status(const simulation &sim) {
+    if (!sim.interrupts) {
+        return "";
+    }
+
+    std::stringstream buffer;
+    buffer << std::fixed << std::setprecision(1);
+    buffer << "Interrupt Status:" << std::endl;
+    buffer << "ISR time: " << sim.isr_time << ", batch: " << sim.irq_batch
+           << ", timeout: " << sim.irq_timeout << std::endl;
+    buffer << "Interrupts: " << sim.interrupts_raised << ", completions delivered: " << sim.irq_completions
+           << ", per interrupt: "
+           << (sim.interrupts_raised > 0 ? double(sim.irq_completions) / sim.interrupts_raised : 0.0) << std::endl;
+    buffer << "Delivery latency: average "
+           << (sim.irq_completions > 0 ? double(sim.irq_latency) / sim.irq_completions : 0.0)
+           << ", max " << sim.max_irq_latency << std::endl;
+    buffer << "ISR CPU time: " << sim.isr_busy << " ("
+           << (sim.current_time > 0 ? 100.0 * sim.isr_busy / sim.current_time : 0.0) << "% of "
+           << sim.current_time << " ms), processes terminated: " << sim.terminated << std::endl;
+
+    return buffer.str();
+}
+
+//Waiting time summary, empty unless --aging or --starvation was given
+std::string print_wait_status(const simulation &sim, unsigned int aging) {
+    if (!sim.wait_report) {
+        return "";
+    }
+
+    double average = sim.admitted > 0 ? (double)sim.total_wait / sim.admitted : 0;
+
+    std::stringstream buffer;
+    buffer << "Wait Status:" << std::endl;
+    if (aging > 0) {
+        buffer << "Aging: one priority level per " << aging << " ms";
+    } else {
+        buffer << "Aging: off";
+    }
+    buffer << ", starvation threshold: " << sim.starvation_threshold << std::endl;
+    buffer << "Average wait: " << std::fixed << std::setprecision(2) << average << " per process"
+           << ", longest wait: " << sim.max_wait;
+    if (sim.max_wait_PID != -1) {
+        buffer << " (PID " << sim.max_wait_PID << ")";
+    }
+    buffer << ", starved processes: " << sim.starved << std::endl;
+
+    return buffer.str();
+}
+
+//Fault rate and throughput of the paging model, empty unless paging is enabled
+std::string print_paging_status(const simulation &sim) {
+    const paging_state &paging = sim.paging;
+    if (!paging.enabled) {
+        return "";
+    }
+
+    auto percent = [](unsigned long part, unsigned long whole) {
+        return whole > 0 ? 100.0 * part / whole : 0.0;
+    };
+    double throughput = sim.current_time > 0 ? 1000.0 * sim.terminated / sim.current_time : 0;
+
+    std::stringstream buffer;
+    buffer << std::fixed << std::setprecision(1);
+    buffer << "Paging Status:" << std::endl;
+    buffer << "Replacement: " << replacement_policy_names[paging.config.policy]
+           << ", frames: " << paging.config.frames
+           << ", page size: " << paging.config.page_size
+           << ", TLB entries: " << paging.config.tlb_entries
+           << ", fault latency: " << paging.config.fault_latency
+           << ", access interval: " << paging.config.access_interval << std::endl;
+    buffer << "Accesses: " << paging.accesses
+           << ", TLB hits: " << paging.tlb_hits << " (" << percent(paging.tlb_hits, paging.accesses) << "%)"
+           << ", page faults: " << paging.faults << " (" << percent(paging.faults, paging.accesses) << "%)"
+           << ", evictions: " << paging.evictions << std::endl;
+    buffer << "Throughput: " << std::setprecision(3) << throughput << " processes per 1000 ms"
+           << ", CPU utilization: " << std::setprecision(1) << percent(sim.cpu_busy, sim.current_time) << "%"
+           << std::endl;
+
+    return buffer.str();
+}
+
+//------------------------------------CLUSTER SIMULATION------------------------------
+//With --nodes=<K> the workload is spread over K nodes, each running this scheduler
+//with its own partition table, CPU, ready and wait queues. A dispatcher places every
+//arrival on a node when it arrives. It cannot see inside the nodes, so it keeps a
+//simple model of each one: the CPU backlog of the work placed there, and when each
+//partition is expected to free up (start after the backlog, plus the process's CPU
+//and I/O time). With --migrate, an arrival the model says will not fit where it was
+//placed goes to the node where a partition big enough frees up first. On another
+//node it arrives after the transfer cost; if that is its own node, it is held there
+//until the partition is free. The nodes then run independently.
+
+//The dispatcher's view of one node
+struct node_model {
+    std::vector<memory_partition>   partitions;
+    std::vector<unsigned int>       release_time;   //expected time each partition is free again
+    unsigned long                   busy_until;     //expected time the CPU clears its backlog
+    std::vector<PCB>                workload;       //processes placed on the node
+};
+
+//Where the dispatcher put a process
+struct placement_record {
+    int             PID;
+    unsigned int    arrival_time;       //arrival at the cluster
+    unsigned int    node;               //numbered from 1
+    unsigned int    first_choice;       //node picked by the placement policy
+    unsigned int    node_arrival_time;  //later than arrival_time if it was migrated, or held for a partition
+};
+
+//Partition the modelled node would give a process of this size at time t (the same
+//last-to-first search as assign_memory), or -1 if none is free
+int model_fit(const node_model &node, unsigned int size, unsigned int t) {
+    for (int i = (int)node.partitions.size() - 1; i >= 0; i--) {
+        if (size <= node.partitions[i].size && node.release_time[i] <= t) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+unsigned long model_backlog(const node_model &node, unsigned int t) {
+    return node.busy_until > t ? node.busy_until - t : 0;
+}
+
+//Pick a node for a process arriving at t
+std::size_t place_process(const std::vector<node_model> &nodes, const PCB &process, unsigned int t,
+                          placement_policies placement, std::size_t &next_node) {
+    std::size_t least_loaded = 0;
+    for (std::size_t n = 1; n < nodes.size(); n++) {
+        if (model_backlog(nodes[n], t) < model_backlog(nodes[least_loaded], t)) {
+            least_loaded = n;
+        }
+    }
+
+    if (placement == PLACE_ROUND_ROBIN) {
+        std::size_t node = next_node;
+        next_node = (next_node + 1) % nodes.size();
+        return node;
+    }
+    if (placement == PLACE_LEAST_LOADED) {
+        return least_loaded;
+    }
+
+    //best fit: least wasted space, then the smaller backlog; least loaded if nothing fits
+    std::size_t best = nodes.size();
+    unsigned int best_waste = 0;
+    for (std::size_t n = 0; n < nodes.size(); n++) {
+        int fit = model_fit(nodes[n], process.size, t);
+        if (fit == -1) {
+            continue;
+        }
+        unsigned int waste = nodes[n].partitions[fit].size - process.size;
+        if (best == nodes.size() || waste < best_waste
+            || (waste == best_waste && model_backlog(nodes[n], t) < model_backlog(nodes[best], t))) {
+            best = n;
+            best_waste = waste;
+        }
+    }
+    return best == nodes.size() ? least_loaded : best;
+}
+
+//Find the node a process that does not fit on origin at time t should go to: the one
+//where a big enough partition is free soonest. Another node can only take it once the
+//transfer is done; staying on origin costs no transfer. Returns false if no node has one.
+bool choose_migration(const std::vector<node_model> &nodes, const PCB &process, std::size_t origin,
+                      unsigned int t, unsigned int transfer_done, std::size_t &node, unsigned int &node_arrival) {
+    bool found = false;
+    for (std::size_t n = 0; n < nodes.size(); n++) {
+        for (std::size_t i = 0; i < nodes[n].partitions.size(); i++) {
+            if (process.size > nodes[n].partitions[i].size) {
+                continue;
+            }
+            unsigned int ready = std::max(n == origin ? t : transfer_done, nodes[n].release_time[i]);
+            if (!found || ready < node_arrival) {
+                found = true;
+                node = n;
+                node_arrival = ready;
+            }
+        }
+    }
+    return found;
+}
+
+//Update the model of a node for a process placed on it
+void model_place(node_model &node, const PCB &process, unsigned int t) {
+    unsigned long start = std::max<unsigned long>(t, node.busy_until);
+    node.busy_until = start + process.processing_time;
+
+    int fit = model_fit(node, process.size, t);
+    if (fit != -1) {
+        unsigned long io_count = process.io_freq > 0 && process.processing_time > 0
+                                 ? (process.processing_time - 1) / process.io_freq : 0;
+        unsigned long finish = node.busy_until + io_count * process.io_duration;
+        node.release_time[fit] = (unsigned int)std::min<unsigned long>(finish, UINT32_MAX);
+    }
+}
+
+//Place every process on a node, in order of arrival
+std::vector<placement_record> place_workload(const std::vector<PCB> &list_processes, const sim_config &config,
+                                             std::vector<node_model> &nodes) {
+    nodes.assign(config.nodes, node_model());
+    for (auto &node : nodes) {
+        make_partitions(config, node.partitions);
+        node.release_time.assign(node.partitions.size(), 0);
+        node.busy_until = 0;
+    }
+
+    std::vector<PCB> arrivals = list_processes;
+    std::stable_sort(arrivals.begin(), arrivals.end(), [](const PCB &a, const PCB &b) {
+        return a.arrival_time < b.arrival_time;
+    });
+
+    std::vector<placement_record> placements;
+    std::size_t next_node = 0;
+    for (const auto &process : arrivals) {
+        unsigned int t = process.arrival_time;
+        std::size_t node = place_process(nodes, process, t, config.placement, next_node);
+        placement_record record = {process.PID, t, (unsigned int)node + 1, (unsigned int)node + 1, t};
+
+        if (config.migration && model_fit(nodes[node], process.size, t) == -1) {
+            unsigned int transfer_done = t + config.migration_latency + config.migration_per_unit * process.size;
+            std::size_t target;
+            unsigned int node_arrival;
+            if (choose_migration(nodes, process, node, t, transfer_done, target, node_arrival)) {
+                node = target;
+                t = node_arrival;
+                record.node = node + 1;
+                record.node_arrival_time = t;
+            }
+        }
+
+        PCB placed = process;
+        placed.arrival_time = t;
+        model_place(nodes[node], placed, t);
+        nodes[node].workload.push_back(placed);
+        placements.push_back(record);
+    }
+
+    //a migrated process can land after later arrivals, and each node expects its
+    //workload in order of arrival
+    for (auto &node : nodes) {
+        std::stable_sort(node.workload.begin(), node.workload.end(), [](const PCB &a, const PCB &b) {
+            return a.arrival_time < b.arrival_time;
+        });
+    }
+    return placements;
+}
+
+//Placement trace, per-node results and cluster-wide totals
+std::string print_cluster_status(const sim_config &config, const std::vector<placement_record> &placements,
+                                 const std::vector<node_model> &nodes, const std::vector<sim_metrics> &metrics) {
+    std::stringstream buffer;
+    const int placementWidth = 58;
+    const int nodeWidth = 86;
+
+    buffer << "Cluster Placement:" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(placementWidth) << "+" << std::endl;
+    buffer << "|"
+           << std::setfill(' ') << std::setw(4) << "PID"
+           << std::setw(2) << "|"
+           << std::setw(8) << "Arrival"
+           << std::setw(2) << "|"
+           << std::setw(7) << "Placed"
+           << std::setw(2) << "|"
+           << std::setw(7) << "Node"
+           << std::setw(2) << "|"
+           << std::setw(8) << "Migrated"
+           << std::setw(2) << "|"
+           << std::setw(13) << "Node Arrival"
+           << std::setw(2) << "|" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(placementWidth) << "+" << std::endl;
+    for (const auto &record : placements) {
+        bool migrated = record.node != record.first_choice;
+        buffer << "|"
+               << std::setfill(' ') << std::setw(4) << record.PID
+               << std::setw(2) << "|"
+               << std::setw(8) << record.arrival_time
+               << std::setw(2) << "|"
+               << std::setw(7) << record.first_choice
+               << std::setw(2) << "|"
+               << std::setw(7) << record.node
+               << std::setw(2) << "|"
+               << std::setw(8) << (migrated ? "yes" : "no")
+               << std::setw(2) << "|"
+               << std::setw(13) << record.node_arrival_time
+               << std::setw(2) << "|" << std::endl;
+    }
+    buffer << "+" << std::setfill('-') << std::setw(placementWidth) << "+" << std::endl;
+
+    buffer << "Node Status:" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(nodeWidth) << "+" << std::endl;
+    buffer << "|"
+           << std::setfill(' ') << std::setw(5) << "Node"
+           << std::setw(2) << "|"
+           << std::setw(10) << "Processes"
+           << std::setw(2) << "|"
+           << std::setw(9) << "Admitted"
+           << std::setw(2) << "|"
+           << std::setw(11) << "Terminated"
+           << std::setw(2) << "|"
+           << std::setw(9) << "End Time"
+           << std::setw(2) << "|"
+           << std::setw(9) << "CPU Busy"
+           << std::setw(2) << "|"
+           << std::setw(12) << "Utilization"
+           << std::setw(2) << "|"
+           << std::setw(8) << "Swaps"
+           << std::setw(2) << "|" << std::endl;
+    buffer << "+" << std::setfill('-') << std::setw(nodeWidth) << "+" << std::endl;
+
+    unsigned int makespan = 0;
+    unsigned long admitted = 0;
+    unsigned long terminated = 0;
+    unsigned long total_busy = 0;
+    unsigned long max_busy = 0;
+    for (std::size_t n = 0; n < nodes.size(); n++) {
+        const sim_metrics &m = metrics[n];
+        double utilization = m.end_time > 0 ? 100.0 * m.cpu_busy / m.end_time : 0;
+        buffer << "|"
+               << std::setfill(' ') << std::setw(5) << n + 1
+               << std::setw(2) << "|"
+               << std::setw(10) << nodes[n].workload.size()
+               << std::setw(2) << "|"
+               << std::setw(9) << m.admitted
+               << std::setw(2) << "|"
+               << std::setw(11) << m.terminated
+               << std::setw(2) << "|"
+               << std::setw(9) << m.end_time
+               << std::setw(2) << "|"
+               << std::setw(9) << m.cpu_busy
+               << std::setw(2) << "|"
+               << std::fixed << std::setprecision(1) << std::setw(11) << utilization << "%"
+               << std::setw(2) << "|"
+               << std::setw(8) << m.swap_outs
+               << std::setw(2) << "|" << std::endl;
+        makespan = std::max(makespan, m.end_time);
+        admitted += m.admitted;
+        terminated += m.terminated;
+        total_busy += m.cpu_busy;
+        max_busy = std::max(max_busy, m.cpu_busy);
+    }
+    buffer << "+" << std::setfill('-') << std::setw(nodeWidth) << "+" << std::endl;
+
+    unsigned long migrations = 0;
+    unsigned long migration_delay = 0;
+    for (const auto &record : placements) {
+        if (record.node != record.first_choice) {
+            migrations++;
+            migration_delay += record.node_arrival_time - record.arrival_time;
+        }
+    }
+    double mean_busy = (double)total_busy / nodes.size();
+    double utilization = makespan > 0 ? 100.0 * total_busy / ((double)makespan * nodes.size()) : 0;
+    double throughput = makespan > 0 ? 1000.0 * terminated / makespan : 0;
+
+    buffer << "Cluster Status:" << std::endl;
+    buffer << "Nodes: " << nodes.size() << ", placement: " << placement_policy_names[config.placement];
+    if (config.migration) {
+        buffer << ", migration cost: " << config.migration_latency << " + " << config.migration_per_unit << " per unit";
+    }
+    buffer << std::endl;
+    buffer << "Processes: " << placements.size() << ", admitted: " << admitted << ", terminated: " << terminated
+           << ", migrations: " << migrations << " (total delay " << migration_delay << ")" << std::endl;
+    buffer << std::setprecision(3) << "Makespan: " << makespan << ", throughput: " << throughput << " processes per 1000 ms"
+           << std::setprecision(1) << ", CPU utilization: " << utilization << "%"
+           << std::setprecision(2) << ", load imbalance (max/mean busy): " << (mean_busy > 0 ? max_busy / mean_busy : 0)
+           << std::endl;
+
+    return buffer.str();
+}
+
+//Run the nodes of a cluster on host threads. Once placed, a node never hears from
+//another one (migration is decided at placement), so each node's events can be
+//processed without waiting on any other: the lookahead between nodes is unbounded.
+//Every node's run is a sequential run of its own workload, written to its own
+//result slot, so the output does not depend on the number of threads or on which
+//thread ran which node. Nodes are handed out through an atomic counter, biggest
+//predicted workload first, to keep the threads evenly loaded.
+void run_nodes(const std::vector<node_model> &nodes, const sim_config &config, unsigned int threads,
+               std::vector<std::tuple<std::string, std::string>> &logs, std::vector<sim_metrics> &metrics) {
+    std::vector<std::size_t> order(nodes.size());
+    for (std::size_t n = 0; n < nodes.size(); n++) {
+        order[n] = n;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return nodes[a].busy_until > nodes[b].busy_until;
+    });
+
+    std::atomic<std::size_t> next_node(0);
+    auto worker = [&]() {
+        std::size_t i;
+        while ((i = next_node.fetch_add(1)) < order.size()) {
+            std::size_t n = order[i];
+            sim_config node_config = config;
+            node_config.nodes = 0;
+            node_config.whole_workload = true;  //a node's work can arrive after a gap
+            node_config.metrics = &metrics[n];
+            logs[n] = run_simulation(nodes[n].workload, node_config);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+}
+
+//Cluster mode: place the workload, run every node and write one pair of logs per
+//node (execution_node<n>.txt, memorylog_node<n>.txt) plus cluster.txt
+int run_cluster(const std::vector<PCB> &list_processes, const sim_config &config) {
+    std::vector<node_model> nodes;
+    std::vector<placement_record> placements = place_workload(list_processes, config, nodes);
+
+    unsigned int threads = config.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<std::size_t>(threads, nodes.size());
+
+    std::vector<std::tuple<std::string, std::string>> logs(nodes.size());
+    std::vector<sim_metrics> metrics(nodes.size(), sim_metrics());
+    run_nodes(nodes, config, threads, logs, metrics);
+
+    for (std::size_t n = 0; n < nodes.size(); n++) {
+        std::string node_name = "_node" + std::to_string(n + 1) + ".txt";
+        write_output(std::get<0>(logs[n]), ("execution" + node_name).c_str());
+        write_output(std::get<1>(logs[n]), ("memorylog" + node_name).c_str());
+    }
+
+    write_output(print_cluster_status(config, placements, nodes, metrics), "cluster.txt");
+    return 0;
+}
+
+//------------------------------------BATCH MODE------------------------------------
+//With --batch the input file lists workload files, one per line, and each is run
+//with the same options. Sweeps over many small workloads then pay for starting the
+//program once instead of per workload, and every host thread reuses its simulation
+//buffers from run to run. A workload's logs are appended to execution.txt and
+//memorylog.txt after a "Workload <file>:" line, exactly as a run of that file alone
+//writes them, and batch.txt gets one line of metrics per workload.
+
+//Read a workload file. Returns false and explains why in error if it cannot be run.
+bool read_workload(const std::string &file_name, const sim_config &config,
+                   std::vector<PCB> &list_processes, std::string &error) {
+    std::ifstream input_file(file_name);
+    if (!input_file.is_open()) {
+        error = "Unable to open file: " + file_name;
+        return false;
+    }
+
+    std::string line;
+    list_processes.clear();
+    while (std::getline(input_file, line)) {
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+        try {
+            list_processes.push_back(add_process(split_delim(line, ", ")));
+        } catch (const std::exception &) {
+            error = file_name + ": bad process line: " + line;
+            return false;
+        }
+        if (list_processes.back().io_device > config.io_devices.size()) {
+            error = file_name + ": process " + std::to_string(list_processes.back().PID)
+                  + " uses an unconfigured I/O device";
+            return false;
+        }
+    }
+    return true;
+}
+
+//Batch mode: run every workload listed in config.input_file
+int run_batch(const sim_config &config) {
+    std::ifstream list_file(config.input_file);
+    if (!list_file.is_open()) {
+        std::cerr << "Error: Unable to open file: " << config.input_file << std::endl;
+        return -1;
+    }
+    std::vector<std::string> workloads;
+    std::string line;
+    while (std::getline(list_file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            workloads.push_back(line);
+        }
+    }
+    if (workloads.empty()) {
+        std::cerr << "Error: No workload files listed in " << config.input_file << std::endl;
+        return -1;
+    }
+
+    std::ofstream execution_file("execution.txt");
+    std::ofstream memory_file("memorylog.txt");
+    std::ofstream summary_file("batch.txt");
+    if (!execution_file.is_open() || !memory_file.is_open() || !summary_file.is_open()) {
+        std::cerr << "Error opening file!" << std::endl;
+        return -1;
+    }
+
+    //Workloads are run a block at a time so the logs held in memory stay bounded.
+    //Within a block they are handed out through an atomic counter; each one writes
+    //its own result slot, so the output does not depend on the number of threads.
+    const std::size_t block_size = 256;
+    unsigned int threads = config.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<std::size_t>(threads, std::min(block_size, workloads.size()));
+
+    std::vector<std::vector<PCB>> lists(block_size);
+    std::vector<std::tuple<std::string, std::string>> logs(block_size);
+    std::vector<sim_metrics> metrics(block_size, sim_metrics());
+    std::vector<std::string> errors(block_size);
+
+    for (std::size_t start = 0; start < workloads.size(); start += block_size) {
+        std::size_t count = std::min(block_size, workloads.size() - start);
+
+        std::atomic<std::size_t> next_workload(0);
+        auto worker = [&]() {
+            std::size_t i;
+            while ((i = next_workload.fetch_add(1)) < count) {
+                errors[i].clear();
+                if (!read_workload(workloads[start + i], config, lists[i], errors[i])) {
+                    continue;
+                }
+                sim_config run_config = config;
+                run_config.batch = false;
+                run_config.metrics = &metrics[i];
+                logs[i] = run_simulation(lists[i], run_config);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned int t = 1; t < threads; t++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : pool) {
+            thread.join();
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            if (!errors[i].empty()) {
+                std::cerr << "Error: " << errors[i] << std::endl;
+                return -1;
+            }
+            const std::string &file_name = workloads[start + i];
+            execution_file << "Workload " << file_name << ":\n" << std::get<0>(logs[i]);
+            memory_file << "Workload " << file_name << ":\n" << std::get<1>(logs[i]);
+            summary_file << file_name << " " << format_metrics(metrics[i]) << "\n";
+        }
+    }
+
+    std::cout << "Ran " << workloads.size() << " workloads, output generated in execution.txt, memorylog.txt and batch.txt" << std::endl;
+    return 0;
+}
+
+//------------------------------------SIMULATION SERVER------------------------------
+//With --serve=<path> the program listens on a Unix domain socket and runs one
+//simulation per connection on a pool of worker threads. A request is:
+//
+//    option lines, using the command line syntax (e.g. --quantum=50), then
+//    a blank line, then
+//    the workload in the input file format, ended by closing the write side.
+//
+//A request may be at most 64 MiB, and is rejected if the client sends nothing for
+//10 seconds before closing its side, or if its logs could need more than 1 GiB.
+//
+//The reply streams the logs back as frames "EXECUTION <length>\n<bytes>" and
+//"MEMORY <length>\n<bytes>" while the run goes, then ends with
+//"DONE end_time=<t> admitted=<n> terminated=<n> cpu_busy=<t> ...\n", or is a single
+//"ERROR <message>\n" line if the request is rejected. An allocation-checking build
+//ends the reply with an ERROR line instead of DONE if the run allocated.
+
+//Sends all of data, returns false if the client went away
+bool send_all(int fd, const char* data, std::size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+//Output stream buffer that sends every write to a socket as one frame
+class frame_sink : public std::streambuf {
+public:
+    frame_sink(int fd, const char* kind) : fd(fd), kind(kind) {}
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize length) override {
+        if (length > 0) {
+            //formatted on the stack: the simulation loop flushes through here and
+            //must not allocate
+            char header[32];
+            std::size_t kind_length = std::strlen(kind);
+            std::memcpy(header, kind, kind_length);
+            header[kind_length] = ' ';
+            char* end = std::to_chars(header + kind_length + 1, header + sizeof(header) - 1, length).ptr;
+            *end++ = '\n';
+            send_all(fd, header, end - header);
+            send_all(fd, data, length);
+        }
+        return length;
+    }
+
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    int         fd;
+    const char* kind;
+};
+
+void send_error(int fd, const std::string &message) {
+    std::string reply = "ERROR " + message + "\n";
+    send_all(fd, reply.data(), reply.size());
+}
+
+//Read one request from a client, run it and stream the result back
+void serve_connection(int fd, const char* policy) {
+    //the whole request is read before the run starts. A client that sends too much,
+    //or stops sending without closing its side, would otherwise hold the worker.
+    const std::size_t max_request_size = 64 << 20;
+    const std::size_t max_request_log_size = std::size_t(1) << 30;
+    timeval timeout = {};
+    timeout.tv_sec = 10;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    thread_local std::string request;
+    request.clear();
+    char buffer[1 << 16];
+    ssize_t received;
+    while ((received = read(fd, buffer, sizeof(buffer))) > 0) {
+        if (request.size() + received > max_request_size) {
+            send_error(fd, "Request larger than " + std::to_string(max_request_size) + " bytes");
+            return;
+        }
+        request.append(buffer, received);
+    }
+    if (received < 0) {
+        send_error(fd, errno == EAGAIN || errno == EWOULDBLOCK ? "Timed out reading the request"
+                                                              : "Unable to read the request");
+        return;
+    }
+
+    sim_config config;
+    std::vector<PCB> list_process;
+    std::istringstream lines(request);
+    std::string line;
+    std::string error;
+
+    //option lines up to the first blank line
+    while (std::getline(lines, line) && !line.empty() && line != "\r") {
+        if (!parse_option(line, config, error)) {
+            send_error(fd, error);
+            return;
+        }
+    }
+    if (!config.policy.empty() && config.policy != policy) {
+        send_error(fd, std::string("This server runs ") + policy + ", not " + config.policy);
+        return;
+    }
+    if (config.stream || !config.serve_path.empty() || config.nodes > 0 || config.batch) {
+        send_error(fd, "--stream, --serve, --nodes and --batch cannot be used in a request");
+        return;
+    }
+    if (!check_config(config, policy, error)) {
+        send_error(fd, error);
+        return;
+    }
+
+    //then the workload
+    while (std::getline(lines, line)) {
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+        try {
+            list_process.push_back(add_process(split_delim(line, ", ")));
+        } catch (const std::exception &) {
+            send_error(fd, "Bad process line: " + line);
+            return;
+        }
+        if (list_process.back().io_device > config.io_devices.size()) {
+            send_error(fd, "Process " + std::to_string(list_process.back().PID) + " uses an unconfigured I/O device");
+            return;
+        }
+    }
+    if (list_process.empty()) {
+        send_error(fd, "Empty workload");
+        return;
+    }
+
+    frame_sink execution_frames(fd, "EXECUTION");
+    frame_sink memory_frames(fd, "MEMORY");
+    std::ostream execution_sink(&execution_frames);
+    std::ostream memory_sink(&memory_frames);
+    sim_metrics metrics = {};
+    config.execution_sink = &execution_sink;
+    config.memory_sink = &memory_sink;
+    config.metrics = &metrics;
+    config.exit_on_allocations = false;  //the server keeps running, the client is told
+    config.max_log_size = max_request_log_size;
+
+    auto [exec, memorystatus] = run_simulation(list_process, config);
+    execution_sink << exec;
+    memory_sink << memorystatus;
+
+    if (metrics.loop_allocations != 0) {
+        send_error(fd, "Simulation loop performed " + std::to_string(metrics.loop_allocations) + " heap allocations");
+        return;
+    }
+    std::string done = "DONE " + format_metrics(metrics) + "\n";
+    send_all(fd, done.data(), done.size());
+}
+
+//Listen on config.serve_path and hand each connection to a worker thread. Runs
+//until the process is killed.
+int run_server(const sim_config &config, const char* policy) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: Unable to create socket" << std::endl;
+        return -1;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (config.serve_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << config.serve_path << std::endl;
+        return -1;
+    }
+    std::strcpy(address.sun_path, config.serve_path.c_str());
+    struct stat existing;
+    if (lstat(config.serve_path.c_str(), &existing) == 0) {
+        //only a socket left by an earlier server is removed; anything else is kept
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::cerr << "Error: Not a socket: " << config.serve_path << std::endl;
+            close(listener);
+            return -1;
+        }
+        unlink(config.serve_path.c_str());
+    }
+
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0) {
+        std::cerr << "Error: Unable to listen on " << config.serve_path << std::endl;
+        close(listener);
+        return -1;
+    }
+
+    unsigned int workers = config.workers;
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::mutex queue_lock;
+    std::condition_variable queue_ready;
+    std::deque<int> connections;
+
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < workers; i++) {
+        pool.emplace_back([&]() {
+            while (true) {
+                int fd;
+                {
+                    std::unique_lock<std::mutex> lock(queue_lock);
+                    queue_ready.wait(lock, [&]() { return !connections.empty(); });
+                    fd = connections.front();
+                    connections.pop_front();
+                }
+                try {
+                    serve_connection(fd, policy);
+                } catch (const std::exception &error) {
+                    //a request must never take the server down with it
+                    send_error(fd, std::string("Request failed: ") + error.what());
+                }
+                close(fd);
+            }
+        });
+    }
+
+    std::cout << policy << " simulation server listening on " << config.serve_path
+              << " with " << workers << " workers" << std::endl;
+
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_lock);
+            connections.push_back(fd);
+        }
+        queue_ready.notify_one();
+    }
+}
+
+//Order the ready queue by priority, lowest PID first. With aging, a process gains one
+//priority level for every aging ms it waits, so at time t its effective priority is
+//PID - (t - ready_since) / aging. For two processes compared at the same t that is
+//the same order as PID * aging + ready_since, which does not change while they wait:
+//no entry is updated as time passes and an order made earlier stays valid.
+void ExternalPriority(const process_table &table, std::vector<uint32_t> &ready_queue, unsigned int aging = 0) {
+    if (aging == 0) {
+        std::sort(ready_queue.begin(), ready_queue.end(), [&](uint32_t a, uint32_t b) {
+            return table.PID[a] < table.PID[b];
+        });
+        return;
+    }
+
+    auto key = [&](uint32_t slot) {
+        return (long long)table.PID[slot] * aging + table.ready_since[slot];
+    };
+    std::sort(ready_queue.begin(), ready_queue.end(), [&](uint32_t a, uint32_t b) {
+        long long key_a = key(a);
+        long long key_b = key(b);
+        return key_a < key_b || (key_a == key_b && table.PID[a] < table.PID[b]);
+    });
+}
+
 #endif
\ No newline at end of file
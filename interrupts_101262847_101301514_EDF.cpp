@@ -0,0 +1,198 @@
+/**
+ * @file interrupts.cpp
+ * @author Radhe Patel & Avnita Ala
+ * @brief main.cpp file for Assignment 3 Part 1 of SYSC4001
+ * 
+ */
+
+#include<interrupts_101262847_101301514.hpp>
+
+//Preemptive real-time scheduler: the ready set is a heap ordered by earliest absolute deadline
+std::tuple<std::string, std::string> run_simulation(std::vector<PCB> list_processes, const sim_config &config) {
+
+    simulation &sim = thread_simulation();  //Process table, ready/wait queues and outputs. The queues
+                                            //hold slots into sim.table rather than copies of PCBs.
+    process_table &table = sim.table;
+
+    init_simulation(sim, list_processes, config, 0, RT_EDF);
+    begin_steady_state(sim);
+
+    //Loop while till there are no ready or waiting processes.
+    while(!all_process_terminated(sim)) {
+
+        //Inside this loop, there are three things you must do:
+        // 1) Populate the ready queue with processes as they arrive, and release the jobs that are due
+        flush_outputs(sim);
+
+        PROFILE_PHASE(sim, PHASE_ADMISSION);
+        admit_arrivals(sim);
+        release_jobs(sim);
+
+        // 2) Manage the wait queue
+        ///////////////////////MANAGE WAIT QUEUE/////////////////////////
+        PROFILE_PHASE(sim, PHASE_WAIT_QUEUE);
+        manage_wait_queue(sim);
+        manage_swapping(sim);
+        /////////////////////////////////////////////////////////////////
+
+        // 3) Run the most urgent job, preempting the running one if needed
+        //////////////////////////SCHEDULER//////////////////////////////
+        PROFILE_PHASE(sim, PHASE_DISPATCH);
+        page_access(sim); //with paging, a page fault blocks the running process
+        if (should_preempt(sim)) {
+            preempt_process(sim);
+        }
+        while (sim.running == NO_PROCESS && !sim.ready_queue.empty()) {
+            run_process(sim);
+
+            // ensure I/O counter is initialized
+            if (table.io_freq[sim.running] > 0 && table.next_io[sim.running] == 0) {
+                table.next_io[sim.running] = table.io_freq[sim.running];
+            }
+            page_access(sim);
+        }
+
+        // 4) execute until the job finishes, needs I/O, or the next event (which may preempt it)
+        unsigned int next_event = next_event_time(sim);
+        unsigned int until_event = next_event > sim.current_time ? next_event - sim.current_time : 1;
+        if (service_interrupt(sim, until_event)) {
+            // the CPU spent this step servicing an I/O interrupt
+        } else if (sim.running != NO_PROCESS && context_switch(sim, until_event)) {
+            // the CPU spent this step switching to the job
+        } else if (sim.running != NO_PROCESS) {
+            uint32_t current = sim.running;
+            bool has_io = table.io_freq[current] > 0;
+
+            unsigned int run_time = std::min(table.remaining_time[current], until_event);
+            if (has_io && table.next_io[current] < run_time) {
+                run_time = table.next_io[current];
+            }
+            if (sim.paging.enabled) {
+                run_time = std::min(run_time, table.next_access[current]); //stop at the next memory access
+                table.next_access[current] -= run_time;
+            }
+
+            table.remaining_time[current] -= run_time;
+            if (has_io) {
+                table.next_io[current] -= run_time;
+            }
+
+            sim.current_time += run_time;
+            sim.cpu_busy += run_time;
+
+            // case 1: job finished
+            if (table.remaining_time[current] == 0) {
+                finish_job(sim);
+            }
+
+            // case 2: need I/O now
+            else if (has_io && table.next_io[current] == 0) {
+                start_io(sim);
+            }
+
+            // otherwise an event is due and the job keeps the CPU unless it is preempted
+        } else {
+            idle_CPU(sim);
+        }
+        /////////////////////////////////////////////////////////////////
+    }
+
+    end_steady_state(sim);
+
+    //Close the output table
+    sim.execution_status += print_exec_footer();
+    sim.execution_status += print_device_status(sim);
+    sim.execution_status += print_swap_status(sim);
+    sim.execution_status += print_paging_status(sim);
+    sim.execution_status += print_wait_status(sim, config.aging);
+    sim.execution_status += print_switch_status(sim);
+    sim.execution_status += print_interrupt_status(sim);
+    sim.execution_status += print_rt_status(sim);
+    collect_metrics(sim, config);
+
+    return std::make_tuple(sim.execution_status, sim.memory_log);
+}
+
+
+int main(int argc, char** argv) {
+
+    //Get the input file from the user
+    if(argc < 2) {
+        std::cout << "ERROR!\nExpected at least 1 argument, received " << argc - 1 << std::endl;
+        std::cout << "To run the program, do: ./interrutps <your_input_file.txt> [options]" << std::endl;
+        print_options();
+        return -1;
+    }
+
+    sim_config config;
+    if (!parse_options(argc, argv, config, "EDF")) {
+        print_options();
+        return -1;
+    }
+
+    //As a server, workloads arrive over a socket instead
+    if (!config.serve_path.empty()) {
+        return run_server(config, "EDF");
+    }
+
+    if (config.input_file.empty()) {
+        std::cout << "ERROR!\nNo input file given" << std::endl;
+        std::cout << "To run the program, do: ./interrutps <your_input_file.txt> [options]" << std::endl;
+        return -1;
+    }
+
+    //In batch mode the input file lists the workload files to run
+    if (config.batch) {
+        int status = run_batch(config);
+        write_profile();
+        return status;
+    }
+
+    //In streaming mode arrivals are read as the simulation reaches them
+    auto file_name = config.input_file.c_str();
+    if (config.stream) {
+        return run_streaming(file_name, config);
+    }
+
+    //Open the input file
+    std::ifstream input_file;
+    input_file.open(file_name);
+
+    //Ensure that the file actually opens
+    if (!input_file.is_open()) {
+        std::cerr << "Error: Unable to open file: " << file_name << std::endl;
+        return -1;
+    }
+
+    //Parse the entire input file and populate a vector of PCBs.
+    //To do so, the add_process() helper function is used (see include file).
+    std::string line;
+    std::vector<PCB> list_process;
+    while(std::getline(input_file, line)) {
+        auto input_tokens = split_delim(line, ", ");
+        auto new_process = add_process(input_tokens);
+        if (new_process.io_device > config.io_devices.size()) {
+            std::cerr << "Error: Process " << new_process.PID << " uses I/O device " << new_process.io_device
+                      << " but only " << config.io_devices.size() << " are configured" << std::endl;
+            return -1;
+        }
+        list_process.push_back(new_process);
+    }
+    input_file.close();
+
+    //In cluster mode the processes are spread over the nodes
+    if (config.nodes > 0) {
+        int status = run_cluster(list_process, config);
+        write_profile();
+        return status;
+    }
+
+    //With the list of processes, run the simulation
+    auto [exec, memorystatus] = run_simulation(list_process, config);
+
+    write_output(exec, "execution.txt");
+    write_output(memorystatus, "memorylog.txt");
+    write_profile();
+
+    return 0;
+}
\ No newline at end of file
@@ -7,222 +7,174 @@
 
 #include<interrupts_101262847_101301514.hpp>
 
-void FCFS(std::vector<PCB> &ready_queue) {
+void FCFS(const process_table &table, std::vector<uint32_t> &ready_queue) {
     std::sort( 
                 ready_queue.begin(),
                 ready_queue.end(),
-                []( const PCB &first, const PCB &second ){
-                    return (first.arrival_time > second.arrival_time); 
+                [&]( uint32_t first, uint32_t second ){
+                    return (table.arrival_time[first] > table.arrival_time[second]); 
                 } 
             );
 }
 
-std::tuple<std::string, std::string> run_simulation(std::vector<PCB> list_processes) {
+std::tuple<std::string, std::string> run_simulation(std::vector<PCB> list_processes, const sim_config &config) {
 
-    std::vector<PCB> ready_queue;   //The ready queue of processes
-    std::vector<PCB> wait_queue;    //The wait queue of processes
-    std::vector<PCB> job_list;      //A list to keep track of all the processes. This is similar
-                                    //to the "Process, Arrival time, Burst time" table that you
-                                    //see in questions. You don't need to use it, I put it here
-                                    //to make the code easier :).
+    simulation &sim = thread_simulation();  //Process table, ready/wait queues and outputs. The queues
+                                            //hold slots into sim.table rather than copies of PCBs.
+    process_table &table = sim.table;
+    const unsigned int quantum = config.quantum; // 100 ms time slice by default
 
-    unsigned int current_time = 0;
-    PCB running;
-
-    //Initialize an empty running process
-    idle_CPU(running);
-
-    std::string execution_status;
-    std::ostringstream memorystream;
-    const unsigned int quantum = 100; // 100 ms time slice
-
-    //make the output table (the header row)
-    execution_status = print_exec_header();
-
-    // Initialize I/O tracking
-    const int MAX_PID = 100;
-    unsigned int time_to_next_io[MAX_PID];
-    unsigned int io_done_time[MAX_PID];
-    bool has_io[MAX_PID];
-
-    for (int i = 0; i < MAX_PID; ++i) {
-        time_to_next_io[i] = 0;
-        io_done_time[i] = 0;
-        has_io[i] = false;
-    }
-    // initialize from input
-    for (auto &p : list_processes) {
-        if (p.PID < MAX_PID && p.io_freq > 0) {
-            time_to_next_io[p.PID] = p.io_freq;
-            has_io[p.PID] = true;
-        }
-    }
+    init_simulation(sim, list_processes, config, quantum);
+    begin_steady_state(sim);
 
     //Loop while till there are no ready or waiting processes.
-    //This is the main reason I have job_list, you don't have to use it.
-    while(!all_process_terminated(job_list) || job_list.empty()) {
+    while(!all_process_terminated(sim)) {
 
         //Inside this loop, there are three things you must do:
         // 1) Populate the ready queue with processes as they arrive
-        for(auto &process : list_processes) {
-            if(process.arrival_time == current_time) {
-                if (assign_memory(process)){
-                    process.state = READY;
-                    ready_queue.push_back(process);
-                    job_list.push_back(process);
-                    execution_status += print_exec_status(current_time, process.PID, NEW, READY);
-                    logMemoryStatus(memorystream);
-                }
-            }
-        }
+        flush_outputs(sim);
+
+        PROFILE_PHASE(sim, PHASE_ADMISSION);
+        admit_arrivals(sim);
         // 2) Manage the wait queue
 
         ///////////////////////MANAGE WAIT QUEUE/////////////////////////
         //This mainly involves keeping track of how long a process must remain in the ready queue
-        for (int i = 0; i < (int)wait_queue.size(); ++i) {
-            PCB &w = wait_queue[i];
-            if (w.PID < MAX_PID && io_done_time[w.PID] <= current_time) {
-                states old_s = w.state;
-                w.state = READY;
-                execution_status += print_exec_status(current_time, w.PID, old_s, READY);
-                ready_queue.push_back(w);
-
-                // sync job_list
-                for (auto &j : job_list) {
-                    if (j.PID == w.PID) {
-                        j.state = READY;
-                        break;
-                    }
-                }
-
-                wait_queue.erase(wait_queue.begin() + i);
-                --i;
-            }
-        }
+        PROFILE_PHASE(sim, PHASE_WAIT_QUEUE);
+        manage_wait_queue(sim);
+        manage_swapping(sim);
         /////////////////////////////////////////////////////////////////
     
         // 3) Schedule processes from the ready queue
         //////////////////////////SCHEDULER//////////////////////////////
-        if (running.PID == -1 && !ready_queue.empty()) {
-            running = ready_queue.front();
-            ready_queue.erase(ready_queue.begin());
-
-            states old_state = running.state;
-            running.state = RUNNING;
-            // first time it runs
-            if (running.start_time == 0) {
-                running.start_time = current_time;
-            }
-            execution_status += print_exec_status(current_time, running.PID, old_state, RUNNING);
+        PROFILE_PHASE(sim, PHASE_DISPATCH);
+        page_access(sim); //with paging, a page fault blocks the running process
+        while (sim.running == NO_PROCESS && !sim.ready_queue.empty()) {
+            run_process(sim);
+            sim.slice_left = quantum;
 
             // ensure I/O counter is initialized
-            if (running.PID < MAX_PID && has_io[running.PID] && time_to_next_io[running.PID] == 0) {
-                time_to_next_io[running.PID] = running.io_freq;
+            if (table.io_freq[sim.running] > 0 && table.next_io[sim.running] == 0) {
+                table.next_io[sim.running] = table.io_freq[sim.running];
             }
+            page_access(sim);
         }
 
-        // 4) execute one quantum (or less) of CPU if something is running
-        if (running.PID != -1) {
-            unsigned int run_time = std::min(running.remaining_time, quantum);
-            if (running.PID < MAX_PID && has_io[running.PID]) {
-                unsigned int &tio = time_to_next_io[running.PID];
-                if (tio < run_time) {
-                    run_time = tio;
-                }
+        // 4) execute one quantum (or less) of CPU if something is running. An interrupt
+        //    service routine or a context switch stops at the next event, so arrivals
+        //    keep their timing.
+        unsigned int next_event = next_event_time(sim);
+        unsigned int until_event = next_event > sim.current_time ? next_event - sim.current_time : 1;
+        if (service_interrupt(sim, until_event)) {
+            // the CPU spent this step servicing an I/O interrupt
+        } else if (sim.running != NO_PROCESS && context_switch(sim, until_event)) {
+            // the CPU spent this step switching to the process
+        } else if (sim.running != NO_PROCESS) {
+            uint32_t current = sim.running;
+            bool has_io = table.io_freq[current] > 0;
+
+            unsigned int run_time = std::min(table.remaining_time[current], sim.slice_left);
+            if (has_io && table.next_io[current] < run_time) {
+                run_time = table.next_io[current];
+            }
+            if (sim.interrupts) {
+                //stop at the next event, so an I/O completion can interrupt the process
+                run_time = std::min(run_time, until_event);
+            }
+            if (sim.paging.enabled) {
+                run_time = std::min(run_time, table.next_access[current]); //stop at the next memory access
+                table.next_access[current] -= run_time;
             }
 
-            running.remaining_time -= run_time;
-            if (running.PID < MAX_PID && has_io[running.PID]) {
-                unsigned int &tio = time_to_next_io[running.PID];
-                if (run_time >= tio) {
-                    tio = 0;  
-                } else {
-                    tio -= run_time;
-                }
+            table.remaining_time[current] -= run_time;
+            if (has_io) {
+                table.next_io[current] -= run_time;
             }
+            sim.slice_left -= run_time;
 
-            current_time += run_time;
+            sim.current_time += run_time;
+            sim.cpu_busy += run_time;
 
             // case 1: process finished
-            if (running.remaining_time == 0) {
-                states old_s = running.state;
-                running.state = TERMINATED;
-                execution_status += print_exec_status(current_time, running.PID, old_s, TERMINATED);
-                free_memory(running);
-                logMemoryStatus(memorystream);
-
-                for (auto &p : job_list) {
-                    if (p.PID == running.PID) {
-                        p.state = TERMINATED;
-                        break;
-                    }
-                }
-
-                idle_CPU(running);
+            if (table.remaining_time[current] == 0) {
+                terminate_process(sim);
             }
 
             // case 2: need I/O now
-            else if (running.PID < MAX_PID && has_io[running.PID] && time_to_next_io[running.PID] == 0) {
-                states old_s = running.state;
-                running.state = WAITING;
-                execution_status += print_exec_status(current_time, running.PID, old_s, WAITING);
-
-                io_done_time[running.PID] = current_time + running.io_duration;
-                time_to_next_io[running.PID] = running.io_freq; // reset for next I/O
-
-                wait_queue.push_back(running);
-
-                for (auto &p : job_list) {
-                    if (p.PID == running.PID) {
-                        p.state = WAITING;
-                        break;
-                    }
-                }
-
-                idle_CPU(running);
+            else if (has_io && table.next_io[current] == 0) {
+                start_io(sim);
             }
 
             // case 3: quantum expired, still CPU left, no I/O
-            else {
-                states old_s = running.state;
-                running.state = READY;
-                execution_status += print_exec_status(current_time, running.PID, old_s, READY);
-
-                ready_queue.push_back(running);
+            else if (sim.slice_left == 0) {
+                preempt_process(sim);
+            }
 
-                for (auto &p : job_list) {
-                    if (p.PID == running.PID) {
-                        p.state = READY;
-                        break;
-                    }
-                }
+            // otherwise it stopped for a memory access and keeps the CPU
 
-                idle_CPU(running);
-            }
         } else {
-            current_time++;
+            idle_CPU(sim);
         }
     }
     /////////////////////////////////////////////////////////////////
     
-    //Close the output table
-    execution_status += print_exec_footer();
+    end_steady_state(sim);
 
-    return std::make_tuple(execution_status, memorystream.str());
+    //Close the output table
+    sim.execution_status += print_exec_footer();
+    sim.execution_status += print_device_status(sim);
+    sim.execution_status += print_swap_status(sim);
+    sim.execution_status += print_paging_status(sim);
+    sim.execution_status += print_wait_status(sim, config.aging);
+    sim.execution_status += print_switch_status(sim);
+    sim.execution_status += print_interrupt_status(sim);
+    collect_metrics(sim, config);
+
+    return std::make_tuple(sim.execution_status, sim.memory_log);
 }
 
 
 int main(int argc, char** argv) {
 
     //Get the input file from the user
-    if(argc != 2) {
-        std::cout << "ERROR!\nExpected 1 argument, received " << argc - 1 << std::endl;
-        std::cout << "To run the program, do: ./interrutps <your_input_file.txt>" << std::endl;
+    if(argc < 2) {
+        std::cout << "ERROR!\nExpected at least 1 argument, received " << argc - 1 << std::endl;
+        std::cout << "To run the program, do: ./interrutps <your_input_file.txt> [options]" << std::endl;
+        print_options();
+        return -1;
+    }
+
+    sim_config config;
+    if (!parse_options(argc, argv, config, "RR")) {
+        print_options();
+        return -1;
+    }
+
+    //As a server, workloads arrive over a socket instead
+    if (!config.serve_path.empty()) {
+        return run_server(config, "RR");
+    }
+
+    if (config.input_file.empty()) {
+        std::cout << "ERROR!\nNo input file given" << std::endl;
+        std::cout << "To run the program, do: ./interrutps <your_input_file.txt> [options]" << std::endl;
         return -1;
     }
 
+    //In batch mode the input file lists the workload files to run
+    if (config.batch) {
+        int status = run_batch(config);
+        write_profile();
+        return status;
+    }
+
+    //In streaming mode arrivals are read as the simulation reaches them
+    auto file_name = config.input_file.c_str();
+    if (config.stream) {
+        return run_streaming(file_name, config);
+    }
+
     //Open the input file
-    auto file_name = argv[1];
     std::ifstream input_file;
     input_file.open(file_name);
 
@@ -239,15 +191,28 @@ int main(int argc, char** argv) {
     while(std::getline(input_file, line)) {
         auto input_tokens = split_delim(line, ", ");
         auto new_process = add_process(input_tokens);
+        if (new_process.io_device > config.io_devices.size()) {
+            std::cerr << "Error: Process " << new_process.PID << " uses I/O device " << new_process.io_device
+                      << " but only " << config.io_devices.size() << " are configured" << std::endl;
+            return -1;
+        }
         list_process.push_back(new_process);
     }
     input_file.close();
 
+    //In cluster mode the processes are spread over the nodes
+    if (config.nodes > 0) {
+        int status = run_cluster(list_process, config);
+        write_profile();
+        return status;
+    }
+
     //With the list of processes, run the simulation
-    auto [exec, memorystatus] = run_simulation(list_process);
+    auto [exec, memorystatus] = run_simulation(list_process, config);
 
     write_output(exec, "execution.txt");
     write_output(memorystatus, "memorylog.txt");
+    write_profile();
 
     return 0;
 }
\ No newline at end of file